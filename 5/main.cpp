@@ -4,9 +4,37 @@
 #include <queue>
 #include <limits>
 #include <chrono>
-#include <iomanip>
 #include <algorithm>
 #include <fstream>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <numeric>
+#include <unordered_set>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdio>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 
 // Structure to represent a weighted edge
 struct Edge {
@@ -14,86 +42,2470 @@ struct Edge {
     int weight;
 };
 
-// Function to generate a connected weighted graph
-std::vector<std::vector<Edge>> generateConnectedWeightedGraph(int vertices, int minConnections) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+// Function to generate a connected weighted graph in O(V + E).
+// A random spanning tree guarantees connectivity, then every vertex is topped up
+// to minConnections distinct neighbours. A hash set of edges rules out duplicates.
+std::vector<std::vector<Edge>> generateConnectedWeightedGraph(int vertices, int minConnections, unsigned seed) {
+    std::mt19937 gen(seed);
     std::uniform_int_distribution<> weightDist(1, 20);
-    std::uniform_int_distribution<> connectionDist(minConnections, vertices-1);
-    
+    std::uniform_int_distribution<> vertexDist(0, std::max(vertices - 1, 0));
+
     std::vector<std::vector<Edge>> graph(vertices);
+    if (vertices < 2) return graph;
+
+    int targetDegree = std::min(minConnections, vertices - 1);
+    std::unordered_set<uint64_t> edges;
+    edges.reserve((size_t)vertices * (targetDegree + 1));
+
+    auto addEdge = [&](int u, int v) {
+        if (u == v) return;
+        uint64_t key = ((uint64_t)std::min(u, v) << 32) | (uint32_t)std::max(u, v);
+        if (!edges.insert(key).second) return;
+        int weight = weightDist(gen);
+        graph[u].push_back({v, weight});
+        graph[v].push_back({u, weight}); // Undirected graph
+    };
+
+    // Random spanning tree: attach each vertex of a random order to an earlier one
+    std::vector<int> order(vertices);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), gen);
+    for (int i = 1; i < vertices; i++) {
+        addEdge(order[i], order[std::uniform_int_distribution<>(0, i - 1)(gen)]);
+    }
+
+    // Extra edges up to the target degree, sampled without replacement
+    for (int u = 0; u < vertices; u++) {
+        while ((int)graph[u].size() < targetDegree) {
+            addEdge(u, vertexDist(gen));
+        }
+    }
+
+    return graph;
+}
+
+// Grid graph with random weights, a rough stand-in for road networks
+std::vector<std::vector<Edge>> generateGridGraph(int rows, int cols, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> weightDist(1, 20);
+
+    std::vector<std::vector<Edge>> graph(rows * cols);
+    auto addEdge = [&](int u, int v) {
+        int weight = weightDist(gen);
+        graph[u].push_back({v, weight});
+        graph[v].push_back({u, weight});
+    };
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            int u = r * cols + c;
+            if (c + 1 < cols) addEdge(u, u + 1);
+            if (r + 1 < rows) addEdge(u, u + cols);
+        }
+    }
+    return graph;
+}
+
+// Output buffer that formats integers with std::to_chars and hands them
+// to the underlying stream in large blocks instead of one insertion per cell
+class BufferedWriter {
+private:
+    std::ostream& out;
+    std::vector<char> buffer;
+    size_t used;
+
+    void reserve(size_t bytes) {
+        if (used + bytes > buffer.size()) flush();
+    }
+
+public:
+    explicit BufferedWriter(std::ostream& stream, size_t capacity = 1 << 20)
+        : out(stream), buffer(capacity), used(0) {}
+
+    ~BufferedWriter() {
+        flush();
+    }
+
+    void write(const char* data, size_t length) {
+        if (length > buffer.size()) {
+            flush();
+            out.write(data, length);
+            return;
+        }
+        reserve(length);
+        std::memcpy(buffer.data() + used, data, length);
+        used += length;
+    }
+
+    void write(const std::string& text) {
+        write(text.data(), text.size());
+    }
+
+    void put(char c) {
+        reserve(1);
+        buffer[used++] = c;
+    }
+
+    // Write value right-aligned in a field of at least width characters (like std::setw)
+    void writeInt(long long value, int width = 0) {
+        char digits[24];
+        auto res = std::to_chars(digits, digits + sizeof(digits), value);
+        int length = res.ptr - digits;
+        int padding = std::max(0, width - length);
+        reserve(padding + length);
+        std::memset(buffer.data() + used, ' ', padding);
+        std::memcpy(buffer.data() + used + padding, digits, length);
+        used += padding + length;
+    }
+
+    template<typename U>
+    void writeRaw(U value) {
+        write(reinterpret_cast<const char*>(&value), sizeof(U));
+    }
+
+    void flush() {
+        if (used) out.write(buffer.data(), used);
+        used = 0;
+    }
+};
+
+// Build the dense weight row of a vertex, 0 where there is no edge.
+// The first edge to a destination wins, as in the adjacency list scan.
+void fillDenseRow(const std::vector<Edge>& edges, std::vector<int>& row) {
+    std::fill(row.begin(), row.end(), 0);
+    for (const Edge& edge : edges) {
+        if (row[edge.dest] == 0) row[edge.dest] = edge.weight;
+    }
+}
+
+// Print adjacency matrix
+void printAdjacencyMatrix(BufferedWriter& writer, const std::vector<std::vector<Edge>>& graph) {
+    int V = graph.size();
+    std::vector<int> row(V);
+
+    writer.write("Adjacency Matrix:\n");
+    for (int i = 0; i < V; i++) {
+        fillDenseRow(graph[i], row);
+        for (int j = 0; j < V; j++) {
+            writer.writeInt(row[j], 4);
+        }
+        writer.put('\n');
+    }
+    writer.put('\n');
+    writer.flush();
+}
+
+// Write adjacency matrix in binary form for graphs too large to read as text.
+// Layout: "ADJM", uint32 vertex count, uint8 bytes per weight (1, 2 or 4),
+// then V*V row-major weights in host byte order, 0 where there is no edge.
+void writeAdjacencyMatrixBinary(std::ostream& out, const std::vector<std::vector<Edge>>& graph) {
+    int V = graph.size();
+    int maxWeight = 0;
+    for (const auto& edges : graph) {
+        for (const Edge& edge : edges) maxWeight = std::max(maxWeight, edge.weight);
+    }
+    uint8_t width = maxWeight <= 0xFF ? 1 : maxWeight <= 0xFFFF ? 2 : 4;
+
+    BufferedWriter writer(out);
+    writer.write("ADJM", 4);
+    writer.writeRaw<uint32_t>(V);
+    writer.writeRaw<uint8_t>(width);
+
+    std::vector<int> row(V);
+    for (int i = 0; i < V; i++) {
+        fillDenseRow(graph[i], row);
+        for (int j = 0; j < V; j++) {
+            if (width == 1) writer.writeRaw<uint8_t>(row[j]);
+            else if (width == 2) writer.writeRaw<uint16_t>(row[j]);
+            else writer.writeRaw<uint32_t>(row[j]);
+        }
+    }
+}
+
+// Read back a matrix written by writeAdjacencyMatrixBinary; true if it holds
+// exactly the dense rows of graph
+bool verifyAdjacencyMatrixBinary(std::istream& in, const std::vector<std::vector<Edge>>& graph) {
+    char magic[4];
+    uint32_t V = 0;
+    uint8_t width = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&V), sizeof(V));
+    in.read(reinterpret_cast<char*>(&width), sizeof(width));
+    if (!in || std::memcmp(magic, "ADJM", 4) != 0 || V != graph.size()) return false;
+    if (width != 1 && width != 2 && width != 4) return false;
+
+    std::vector<int> row(V);
+    for (uint32_t i = 0; i < V; i++) {
+        fillDenseRow(graph[i], row);
+        for (uint32_t j = 0; j < V; j++) {
+            uint8_t narrow;
+            uint16_t medium;
+            uint32_t cell;
+            if (width == 1) {
+                in.read(reinterpret_cast<char*>(&narrow), 1);
+                cell = narrow;
+            } else if (width == 2) {
+                in.read(reinterpret_cast<char*>(&medium), 2);
+                cell = medium;
+            } else {
+                in.read(reinterpret_cast<char*>(&cell), 4);
+            }
+            if (!in || cell != (uint32_t)row[j]) return false;
+        }
+    }
+    return in.peek() == std::char_traits<char>::eof();
+}
+
+// Dijkstra's algorithm implementation
+std::vector<int> dijkstra(const std::vector<std::vector<Edge>>& graph, int start) {
+    int V = graph.size();
+    std::vector<int> dist(V, std::numeric_limits<int>::max());
+    dist[start] = 0;
+    
+    std::priority_queue<std::pair<int,int>, std::vector<std::pair<int,int>>, std::greater<>> pq;
+    pq.push({0, start});
     
-    // First ensure minimum connectivity by connecting each vertex to minConnections others
-    for (int i = 0; i < vertices; i++) {
-        std::vector<int> possibleConnections;
-        for (int j = 0; j < vertices; j++) {
-            if (i != j) possibleConnections.push_back(j);
+    while (!pq.empty()) {
+        int u = pq.top().second;
+        int d = pq.top().first;
+        pq.pop();
+        
+        if (d > dist[u]) continue;
+        
+        for (const Edge& edge : graph[u]) {
+            int v = edge.dest;
+            int weight = edge.weight;
+            
+            if (dist[u] + weight < dist[v]) {
+                dist[v] = dist[u] + weight;
+                pq.push({dist[v], v});
+            }
+        }
+    }
+    
+    return dist;
+}
+
+// Weighted graph in CSR form with destinations and weights in separate arrays,
+// so the edges of a vertex can be loaded eight at a time
+struct WeightedCSR {
+    std::vector<int> offset;
+    std::vector<int> dest;
+    std::vector<int> weight;
+
+    explicit WeightedCSR(const std::vector<std::vector<Edge>>& graph) : offset(graph.size() + 1, 0) {
+        for (size_t u = 0; u < graph.size(); u++) {
+            offset[u + 1] = offset[u] + graph[u].size();
+        }
+        dest.reserve(offset.back());
+        weight.reserve(offset.back());
+        for (const auto& edges : graph) {
+            for (const Edge& edge : edges) {
+                dest.push_back(edge.dest);
+                weight.push_back(edge.weight);
+            }
+        }
+    }
+
+    int vertexCount() const {
+        return offset.size() - 1;
+    }
+};
+
+// Dijkstra on the CSR layout. With AVX2 the relaxation gathers dist[dest] for eight
+// edges, adds the weights and compares in SIMD lanes; only improved lanes are
+// written back and pushed. Build with -mavx2 (or -march=native) to enable it.
+std::vector<int> dijkstraCSR(const WeightedCSR& graph, int start) {
+    int V = graph.vertexCount();
+    std::vector<int> dist(V, std::numeric_limits<int>::max());
+    dist[start] = 0;
+
+    std::priority_queue<std::pair<int,int>, std::vector<std::pair<int,int>>, std::greater<>> pq;
+    pq.push({0, start});
+
+    const int* dest = graph.dest.data();
+    const int* weight = graph.weight.data();
+
+    while (!pq.empty()) {
+        int u = pq.top().second;
+        int d = pq.top().first;
+        pq.pop();
+
+        if (d > dist[u]) continue;
+
+        int e = graph.offset[u];
+        int end = graph.offset[u + 1];
+#if defined(__AVX2__)
+        __m256i vd = _mm256_set1_epi32(d);
+        for (; e + 8 <= end; e += 8) {
+            __m256i idx = _mm256_loadu_si256((const __m256i*)(dest + e));
+            __m256i nd = _mm256_add_epi32(vd, _mm256_loadu_si256((const __m256i*)(weight + e)));
+            __m256i cur = _mm256_i32gather_epi32(dist.data(), idx, 4);
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(cur, nd)));
+            while (mask) {
+                int lane = __builtin_ctz(mask);
+                mask &= mask - 1;
+                // Recheck: an earlier lane may already have lowered the same vertex
+                int v = dest[e + lane];
+                int candidate = d + weight[e + lane];
+                if (candidate < dist[v]) {
+                    dist[v] = candidate;
+                    pq.push({candidate, v});
+                }
+            }
+        }
+#endif
+        for (; e < end; e++) {
+            int v = dest[e];
+            int candidate = d + weight[e];
+            if (candidate < dist[v]) {
+                dist[v] = candidate;
+                pq.push({candidate, v});
+            }
+        }
+    }
+
+    return dist;
+}
+
+// Result of a single source-target query
+struct PathResult {
+    int distance;          // std::numeric_limits<int>::max() if target is unreachable
+    std::vector<int> path; // source ... target, empty if target is unreachable
+    int settled;           // number of vertices settled by the search
+};
+
+// Follow predecessor links back from target and return the path in source-to-target order
+std::vector<int> reconstructPath(const std::vector<int>& parent, int source, int target) {
+    std::vector<int> path;
+    for (int v = target; v != -1; v = parent[v]) {
+        path.push_back(v);
+        if (v == source) break;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+// Bidirectional Dijkstra for a single source-target pair.
+// The graph is undirected, so the backward search runs on the same adjacency lists.
+// Stops as soon as the smallest keys of both queues add up to at least the best path seen.
+PathResult bidirectionalDijkstra(const std::vector<std::vector<Edge>>& graph, int source, int target) {
+    const int INF = std::numeric_limits<int>::max();
+    int V = graph.size();
+    PathResult result{INF, {}, 0};
+    if (source == target) {
+        result.distance = 0;
+        result.path = {source};
+        return result;
+    }
+
+    std::vector<int> dist[2] = {std::vector<int>(V, INF), std::vector<int>(V, INF)};
+    std::vector<int> parent[2] = {std::vector<int>(V, -1), std::vector<int>(V, -1)};
+    std::vector<char> settled[2] = {std::vector<char>(V, 0), std::vector<char>(V, 0)};
+    std::priority_queue<std::pair<int,int>, std::vector<std::pair<int,int>>, std::greater<>> pq[2];
+
+    dist[0][source] = 0;
+    dist[1][target] = 0;
+    pq[0].push({0, source});
+    pq[1].push({0, target});
+
+    int best = INF;
+    int meeting = -1;
+
+    while (!pq[0].empty() && !pq[1].empty()) {
+        // Meeting-point stopping rule
+        if (best != INF && pq[0].top().first + pq[1].top().first >= best) break;
+
+        // Advance the side with the smaller queue
+        int side = pq[0].size() <= pq[1].size() ? 0 : 1;
+        int other = 1 - side;
+
+        int u = pq[side].top().second;
+        int d = pq[side].top().first;
+        pq[side].pop();
+
+        if (d > dist[side][u] || settled[side][u]) continue;
+        settled[side][u] = 1;
+        result.settled++;
+
+        for (const Edge& edge : graph[u]) {
+            int v = edge.dest;
+            int nd = d + edge.weight;
+
+            if (nd < dist[side][v]) {
+                dist[side][v] = nd;
+                parent[side][v] = u;
+                pq[side].push({nd, v});
+            }
+            if (dist[other][v] != INF && nd + dist[other][v] < best) {
+                best = nd + dist[other][v];
+                meeting = v;
+            }
+        }
+    }
+
+    if (meeting == -1) return result;
+
+    result.distance = best;
+    result.path = reconstructPath(parent[0], source, meeting);
+    for (int v = parent[1][meeting]; v != -1; v = parent[1][v]) {
+        result.path.push_back(v);
+    }
+    return result;
+}
+
+// Heuristic that always returns 0, turns A* into plain Dijkstra with early exit
+struct ZeroHeuristic {
+    int operator()(int, int) const { return 0; }
+};
+
+// ALT (A*, landmarks, triangle inequality) heuristic.
+// Distances from a few landmarks give the lower bound |d(L, t) - d(L, v)| <= d(v, t),
+// which is admissible and consistent on undirected graphs.
+class LandmarkHeuristic {
+private:
+    std::vector<std::vector<int>> landmarkDist;
+
+public:
+    LandmarkHeuristic(const std::vector<std::vector<Edge>>& graph, int numLandmarks, std::mt19937& gen) {
+        int V = graph.size();
+        std::uniform_int_distribution<> vertexDist(0, V - 1);
+        for (int i = 0; i < std::min(numLandmarks, V); i++) {
+            landmarkDist.push_back(dijkstra(graph, vertexDist(gen)));
+        }
+    }
+
+    int operator()(int v, int target) const {
+        const int INF = std::numeric_limits<int>::max();
+        int bound = 0;
+        for (const auto& dist : landmarkDist) {
+            if (dist[v] == INF || dist[target] == INF) continue;
+            bound = std::max(bound, std::abs(dist[target] - dist[v]));
+        }
+        return bound;
+    }
+};
+
+// A* search for a single source-target pair.
+// Heuristic is called as h(v, target) and must never overestimate the remaining distance.
+template<typename Heuristic>
+PathResult aStar(const std::vector<std::vector<Edge>>& graph, int source, int target, const Heuristic& h) {
+    const int INF = std::numeric_limits<int>::max();
+    int V = graph.size();
+    PathResult result{INF, {}, 0};
+
+    std::vector<int> dist(V, INF);
+    std::vector<int> parent(V, -1);
+    std::vector<char> settled(V, 0);
+    dist[source] = 0;
+
+    // Queue is keyed by dist + h
+    std::priority_queue<std::pair<int,int>, std::vector<std::pair<int,int>>, std::greater<>> pq;
+    pq.push({h(source, target), source});
+
+    while (!pq.empty()) {
+        int u = pq.top().second;
+        pq.pop();
+
+        if (settled[u]) continue;
+        settled[u] = 1;
+        result.settled++;
+
+        if (u == target) break;
+
+        for (const Edge& edge : graph[u]) {
+            int v = edge.dest;
+            int nd = dist[u] + edge.weight;
+
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                parent[v] = u;
+                pq.push({nd + h(v, target), v});
+            }
+        }
+    }
+
+    if (dist[target] == INF) return result;
+
+    result.distance = dist[target];
+    result.path = reconstructPath(parent, source, target);
+    return result;
+}
+
+// Distance types for the Floyd-Warshall kernel, INF + INF must not overflow
+template<typename Dist> struct DistTraits;
+
+template<> struct DistTraits<int32_t> {
+    static constexpr int32_t INF = 0x3FFFFFFF;
+    static int32_t add(int32_t a, int32_t b) { return a + b; }
+};
+
+// 16-bit distances use saturating addition, so INF is simply the largest value
+template<> struct DistTraits<uint16_t> {
+    static constexpr uint16_t INF = 0xFFFF;
+    static uint16_t add(uint16_t a, uint16_t b) { return std::min(a + b, 0xFFFF); }
+};
+
+// Tile edge in elements: a 64x64 int32 tile is 16 KB, so the three tiles
+// of one update stay within L1/L2
+const int FW_BLOCK = 64;
+
+// c[j] = min(c[j], a + b[j]) for one tile row.
+// Vector paths are taken when compiled with -mavx2 or -mavx512f (-march=native).
+inline void minPlusRow(int32_t* c, const int32_t* b, int32_t a) {
+    int j = 0;
+#if defined(__AVX512F__)
+    __m512i va = _mm512_set1_epi32(a);
+    for (; j < FW_BLOCK; j += 16) {
+        __m512i sum = _mm512_add_epi32(va, _mm512_loadu_si512(b + j));
+        _mm512_storeu_si512(c + j, _mm512_min_epi32(_mm512_loadu_si512(c + j), sum));
+    }
+#elif defined(__AVX2__)
+    __m256i va = _mm256_set1_epi32(a);
+    for (; j < FW_BLOCK; j += 8) {
+        __m256i sum = _mm256_add_epi32(va, _mm256_loadu_si256((const __m256i*)(b + j)));
+        __m256i cur = _mm256_loadu_si256((const __m256i*)(c + j));
+        _mm256_storeu_si256((__m256i*)(c + j), _mm256_min_epi32(cur, sum));
+    }
+#endif
+    for (; j < FW_BLOCK; j++) {
+        c[j] = std::min(c[j], a + b[j]);
+    }
+}
+
+inline void minPlusRow(uint16_t* c, const uint16_t* b, uint16_t a) {
+    int j = 0;
+#if defined(__AVX512BW__)
+    __m512i va = _mm512_set1_epi16(a);
+    for (; j < FW_BLOCK; j += 32) {
+        __m512i sum = _mm512_adds_epu16(va, _mm512_loadu_si512(b + j));
+        _mm512_storeu_si512(c + j, _mm512_min_epu16(_mm512_loadu_si512(c + j), sum));
+    }
+#elif defined(__AVX2__)
+    __m256i va = _mm256_set1_epi16(a);
+    for (; j < FW_BLOCK; j += 16) {
+        __m256i sum = _mm256_adds_epu16(va, _mm256_loadu_si256((const __m256i*)(b + j)));
+        __m256i cur = _mm256_loadu_si256((const __m256i*)(c + j));
+        _mm256_storeu_si256((__m256i*)(c + j), _mm256_min_epu16(cur, sum));
+    }
+#endif
+    for (; j < FW_BLOCK; j++) {
+        c[j] = std::min(c[j], DistTraits<uint16_t>::add(a, b[j]));
+    }
+}
+
+// Relax tile C through tiles A (rows of C, pivot columns) and B (pivot rows, columns of C).
+// k is the outer loop, so C may alias A or B as it does for the pivot row, column and diagonal.
+template<typename Dist>
+void updateTile(Dist* C, const Dist* A, const Dist* B, int stride) {
+    for (int k = 0; k < FW_BLOCK; k++) {
+        const Dist* bRow = B + (size_t)k * stride;
+        for (int i = 0; i < FW_BLOCK; i++) {
+            minPlusRow(C + (size_t)i * stride, bRow, A[(size_t)i * stride + k]);
+        }
+    }
+}
+
+// Barrier for a fixed set of threads, reusable for any number of phases.
+// Waiting threads yield instead of sleeping: phases are short, and yielding
+// still lets other threads run when there are more threads than cores.
+class PhaseBarrier {
+private:
+    const int threads;
+    std::atomic<int> waiting;
+    std::atomic<unsigned> phase;
+
+public:
+    explicit PhaseBarrier(int count) : threads(count), waiting(0), phase(0) {}
+
+    void arriveAndWait() {
+        unsigned current = phase.load(std::memory_order_acquire);
+        if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == threads) {
+            waiting.store(0, std::memory_order_relaxed);
+            phase.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        while (phase.load(std::memory_order_acquire) == current) std::this_thread::yield();
+    }
+};
+
+// Blocked Floyd-Warshall on a padded n x n row-major matrix (n is a multiple of FW_BLOCK).
+// Each round handles the diagonal tile, then the pivot row and column tiles,
+// then all remaining tiles; tiles within the last two phases are independent.
+// The threads are started once and split every phase between them (the tiles
+// are all the same size), with a barrier after each phase.
+template<typename Dist>
+void blockedFloydWarshall(std::vector<Dist>& d, int n, int threads) {
+    int nb = n / FW_BLOCK;
+    auto tile = [&](int bi, int bj) { return d.data() + (size_t)bi * FW_BLOCK * n + (size_t)bj * FW_BLOCK; };
+    threads = std::max(1, std::min(threads, (nb - 1) * (nb - 1)));
+    PhaseBarrier barrier(threads);
+
+    auto work = [&](int t) {
+        for (int kb = 0; kb < nb; kb++) {
+            Dist* pivot = tile(kb, kb);
+            if (t == 0) updateTile(pivot, pivot, pivot, n);
+            barrier.arriveAndWait();
+
+            for (int idx = t; idx < 2 * (nb - 1); idx += threads) {
+                int other = idx % (nb - 1);
+                if (other >= kb) other++;
+                if (idx < nb - 1) {
+                    updateTile(tile(kb, other), pivot, tile(kb, other), n);
+                } else {
+                    updateTile(tile(other, kb), tile(other, kb), pivot, n);
+                }
+            }
+            barrier.arriveAndWait();
+
+            for (int idx = t; idx < (nb - 1) * (nb - 1); idx += threads) {
+                int bi = idx / (nb - 1), bj = idx % (nb - 1);
+                if (bi >= kb) bi++;
+                if (bj >= kb) bj++;
+                updateTile(tile(bi, bj), tile(bi, kb), tile(kb, bj), n);
+            }
+            barrier.arriveAndWait();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) workers.emplace_back(work, t);
+    work(0);
+    for (auto& worker : workers) worker.join();
+}
+
+// All-pairs distances with the blocked kernel, int max for unreachable pairs as in dijkstra
+template<typename Dist>
+std::vector<std::vector<int>> floydWarshall(const std::vector<std::vector<Edge>>& graph, int threads) {
+    const Dist INF = DistTraits<Dist>::INF;
+    int V = graph.size();
+    int n = (V + FW_BLOCK - 1) / FW_BLOCK * FW_BLOCK;
+
+    std::vector<Dist> d((size_t)n * n, INF);
+    for (int i = 0; i < n; i++) d[(size_t)i * n + i] = 0;
+    for (int u = 0; u < V; u++) {
+        for (const Edge& edge : graph[u]) {
+            Dist& cell = d[(size_t)u * n + edge.dest];
+            cell = std::min<Dist>(cell, edge.weight);
+        }
+    }
+
+    blockedFloydWarshall(d, n, threads);
+
+    std::vector<std::vector<int>> dist(V, std::vector<int>(V));
+    for (int i = 0; i < V; i++) {
+        for (int j = 0; j < V; j++) {
+            Dist value = d[(size_t)i * n + j];
+            dist[i][j] = value == INF ? std::numeric_limits<int>::max() : value;
+        }
+    }
+    return dist;
+}
+
+enum class ApspMethod { Auto, Dijkstra, FloydWarshall };
+
+// Cost model for picking an APSP method, in ns per unit of work on one core
+struct ApspCostModel {
+    double dijkstraHeapCost; // per step of heap work, see dijkstraHeapWork
+    double dijkstraArcCost;  // per arc scanned from one source
+    double fwCellCost16;     // per min-plus update
+    double fwCellCost32;
+};
+
+// Heap steps of one Dijkstra run: with lazy deletion a vertex is pushed once per
+// improvement of its distance, about 1 + ln(average degree) times on random
+// graphs, and every push and pop costs log2 V
+double dijkstraHeapWork(int V, long long arcs) {
+    double degree = std::max(1.0, (double)arcs / V);
+    return V * std::log2(V) * (1 + std::log(degree));
+}
+
+// Fit the cost model to this machine and build: V Dijkstra runs on a sparser and
+// a denser probe graph give the heap and arc costs, one-thread Floyd-Warshall on
+// the sparser one the cell costs. Dijkstra's cost is not quite linear in the
+// arcs, so the probe degrees bracket the densities where the methods cross over
+// and the fit is closest there. Each time is the best of a few runs; the whole
+// probe takes a few tens of milliseconds.
+ApspCostModel measureApspCostModel() {
+    const int V = 256;
+    const int REPEATS = 3;
+    auto bestTime = [&](auto run) {
+        double best = std::numeric_limits<double>::max();
+        for (int r = 0; r < REPEATS; r++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            run();
+            auto end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+        }
+        return best;
+    };
+    auto arcCount = [](const std::vector<std::vector<Edge>>& graph) {
+        long long arcs = 0;
+        for (const auto& edges : graph) arcs += edges.size();
+        return arcs;
+    };
+
+    auto sparse = generateConnectedWeightedGraph(V, 8, 1);
+    auto dense = generateConnectedWeightedGraph(V, 32, 2);
+    auto allSources = [&](const std::vector<std::vector<Edge>>& graph) {
+        return bestTime([&]() {
+            for (int source = 0; source < V; source++) dijkstra(graph, source);
+        }) / V;
+    };
+    // Per source: time = heap * heap work + arc * arcs, solved from the two graphs
+    double sparseTime = allSources(sparse), denseTime = allSources(dense);
+    long long sparseArcs = arcCount(sparse), denseArcs = arcCount(dense);
+
+    double sparseHeap = dijkstraHeapWork(V, sparseArcs), denseHeap = dijkstraHeapWork(V, denseArcs);
+    double det = sparseHeap * denseArcs - denseHeap * sparseArcs;
+
+    ApspCostModel model;
+    model.dijkstraHeapCost = std::max(0.01, (sparseTime * denseArcs - denseTime * sparseArcs) / det);
+    model.dijkstraArcCost = std::max(0.01, (sparseHeap * denseTime - denseHeap * sparseTime) / det);
+    double cells = (double)V * V * V;
+    model.fwCellCost16 = bestTime([&]() { floydWarshall<uint16_t>(sparse, 1); }) / cells;
+    model.fwCellCost32 = bestTime([&]() { floydWarshall<int32_t>(sparse, 1); }) / cells;
+    return model;
+}
+
+const ApspCostModel& apspCostModel() {
+    static const ApspCostModel model = measureApspCostModel();
+    return model;
+}
+
+// 16-bit distances are used when every shortest path fits and the kernel is faster for them
+bool useUint16(int V, int maxWeight) {
+    bool fits = (long long)maxWeight * std::max(V - 1, 0) < DistTraits<uint16_t>::INF;
+    return fits && apspCostModel().fwCellCost16 < apspCostModel().fwCellCost32;
+}
+
+// True when the blocked Floyd-Warshall kernel is expected to beat V Dijkstra runs
+bool preferFloydWarshall(int V, long long arcs, int maxWeight, int threads) {
+    if (V < 2) return false;
+    const ApspCostModel& model = apspCostModel();
+    double dijkstraCost = (double)V * (model.dijkstraHeapCost * dijkstraHeapWork(V, arcs) + model.dijkstraArcCost * arcs);
+    double cellCost = useUint16(V, maxWeight) ? model.fwCellCost16 : model.fwCellCost32;
+    double fwCost = cellCost * V * V * V / std::max(threads, 1);
+    return fwCost < dijkstraCost;
+}
+
+// All-pairs shortest paths: V Dijkstra runs on sparse graphs, blocked
+// Floyd-Warshall on dense ones, whichever the cost model expects to be faster
+std::vector<std::vector<int>> allPairsShortestPaths(const std::vector<std::vector<Edge>>& graph,
+                                                    ApspMethod method = ApspMethod::Auto, int threads = 0) {
+    int V = graph.size();
+    long long arcs = 0;
+    int maxWeight = 0;
+    for (const auto& edges : graph) {
+        arcs += edges.size();
+        for (const Edge& edge : edges) maxWeight = std::max(maxWeight, edge.weight);
+    }
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (method == ApspMethod::Auto) {
+        method = preferFloydWarshall(V, arcs, maxWeight, threads) ? ApspMethod::FloydWarshall : ApspMethod::Dijkstra;
+    }
+
+    if (method == ApspMethod::Dijkstra) {
+        std::vector<std::vector<int>> dist(V);
+        for (int source = 0; source < V; source++) {
+            dist[source] = dijkstra(graph, source);
+        }
+        return dist;
+    }
+
+    if (useUint16(V, maxWeight)) {
+        return floydWarshall<uint16_t>(graph, threads);
+    }
+    return floydWarshall<int32_t>(graph, threads);
+}
+
+// Contraction hierarchy for repeated distance queries on a fixed graph.
+// Vertices are contracted in order of edge difference; each contraction adds
+// shortcuts between neighbours unless a witness search finds a path that is
+// no longer. Queries run Dijkstra upwards from both ends.
+// The graph is undirected, so the downward graph is the upward graph reversed
+// and the backward search can use the same upward lists.
+class ContractionHierarchy {
+private:
+    // Settle limits of witness searches; a cut-off search only adds a redundant shortcut
+    static const int WITNESS_SETTLE_LIMIT = 500;
+    static const int SIMULATION_SETTLE_LIMIT = 50;
+
+    int V;
+    std::vector<int> rank;
+    std::vector<int> upOffset; // upward graph in CSR form
+    std::vector<Edge> upEdges;
+    long long shortcuts;
+
+    // Preprocessing state
+    std::vector<std::vector<Edge>> adj;
+    std::vector<int> deletedNeighbours;
+    std::vector<int> witnessDist;
+    std::vector<int> witnessTouched;
+
+    // Query workspace, reused so that a query does not allocate
+    std::vector<int> dist[2];
+    std::vector<int> touched[2];
+    std::vector<std::pair<int,int>> heap[2];
+    int settledCount;
+
+    // Returns true if the arc is new, false if an existing one was shortened
+    bool addOrShortenEdge(int u, int w, int weight) {
+        for (Edge& edge : adj[u]) {
+            if (edge.dest == w) {
+                edge.weight = std::min(edge.weight, weight);
+                return false;
+            }
+        }
+        adj[u].push_back({w, weight});
+        return true;
+    }
+
+    // Dijkstra from source in the remaining graph without vertex skip, up to maxDist
+    void witnessSearch(int source, int skip, int maxDist, int settleLimit) {
+        for (int v : witnessTouched) witnessDist[v] = std::numeric_limits<int>::max();
+        witnessTouched.clear();
+
+        std::priority_queue<std::pair<int,int>, std::vector<std::pair<int,int>>, std::greater<>> pq;
+        witnessDist[source] = 0;
+        witnessTouched.push_back(source);
+        pq.push({0, source});
+
+        int settled = 0;
+        while (!pq.empty() && settled < settleLimit) {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (d > witnessDist[u]) continue;
+            if (d > maxDist) break;
+            settled++;
+
+            for (const Edge& edge : adj[u]) {
+                int v = edge.dest;
+                if (v == skip) continue;
+                int nd = d + edge.weight;
+                if (nd < witnessDist[v]) {
+                    if (witnessDist[v] == std::numeric_limits<int>::max()) witnessTouched.push_back(v);
+                    witnessDist[v] = nd;
+                    pq.push({nd, v});
+                }
+            }
+        }
+    }
+
+    // Count the shortcuts needed to contract v; with apply, add them and
+    // count only those that are new arcs rather than shortened edges
+    int contract(int v, bool apply) {
+        const std::vector<Edge> neighbours = adj[v];
+        int added = 0;
+
+        for (size_t i = 0; i < neighbours.size(); i++) {
+            int maxVia = 0;
+            for (size_t j = i + 1; j < neighbours.size(); j++) {
+                maxVia = std::max(maxVia, neighbours[j].weight);
+            }
+            if (maxVia == 0) continue;
+
+            int u = neighbours[i].dest;
+            witnessSearch(u, v, neighbours[i].weight + maxVia,
+                          apply ? WITNESS_SETTLE_LIMIT : SIMULATION_SETTLE_LIMIT);
+
+            for (size_t j = i + 1; j < neighbours.size(); j++) {
+                int w = neighbours[j].dest;
+                int via = neighbours[i].weight + neighbours[j].weight;
+                if (witnessDist[w] <= via) continue;
+                if (!apply) {
+                    added++;
+                    continue;
+                }
+                bool isNew = addOrShortenEdge(u, w, via);
+                addOrShortenEdge(w, u, via);
+                if (isNew) added++;
+            }
+        }
+        return added;
+    }
+
+    int priority(int v) {
+        return contract(v, false) - (int)adj[v].size() + deletedNeighbours[v];
+    }
+
+public:
+    explicit ContractionHierarchy(const std::vector<std::vector<Edge>>& graph)
+        : V(graph.size()), rank(V, -1), shortcuts(0), adj(graph), deletedNeighbours(V, 0),
+          witnessDist(V, std::numeric_limits<int>::max()), settledCount(0) {
+        for (int s = 0; s < 2; s++) dist[s].assign(V, std::numeric_limits<int>::max());
+
+        // Drop parallel edges, keeping the lightest
+        for (auto& edges : adj) {
+            std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+                return a.dest != b.dest ? a.dest < b.dest : a.weight < b.weight;
+            });
+            edges.erase(std::unique(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+                return a.dest == b.dest;
+            }), edges.end());
+        }
+
+        std::priority_queue<std::pair<int,int>, std::vector<std::pair<int,int>>, std::greater<>> order;
+        for (int v = 0; v < V; v++) order.push({priority(v), v});
+
+        std::vector<std::vector<Edge>> up(V);
+        int nextRank = 0;
+        while (!order.empty()) {
+            int v = order.top().second;
+            order.pop();
+            if (rank[v] != -1) continue;
+
+            // Lazy update: contract only if v is still the cheapest vertex
+            int p = priority(v);
+            if (!order.empty() && p > order.top().first) {
+                order.push({p, v});
+                continue;
+            }
+
+            shortcuts += contract(v, true);
+            rank[v] = nextRank++;
+            up[v] = adj[v];
+
+            for (const Edge& edge : adj[v]) {
+                int u = edge.dest;
+                auto& list = adj[u];
+                list.erase(std::remove_if(list.begin(), list.end(), [v](const Edge& e) { return e.dest == v; }),
+                           list.end());
+                deletedNeighbours[u]++;
+            }
+            adj[v].clear();
+        }
+
+        upOffset.assign(V + 1, 0);
+        for (int v = 0; v < V; v++) upOffset[v + 1] = upOffset[v] + up[v].size();
+        upEdges.reserve(upOffset[V]);
+        for (int v = 0; v < V; v++) upEdges.insert(upEdges.end(), up[v].begin(), up[v].end());
+
+        adj.clear();
+        adj.shrink_to_fit();
+        witnessDist.clear();
+        witnessDist.shrink_to_fit();
+    }
+
+    long long shortcutCount() const {
+        return shortcuts;
+    }
+
+    // Vertices settled by the last query
+    int lastSettled() const {
+        return settledCount;
+    }
+
+    // Shortest distance between source and target, int max if unreachable
+    int query(int source, int target) {
+        const int INF = std::numeric_limits<int>::max();
+        for (int s = 0; s < 2; s++) {
+            for (int v : touched[s]) dist[s][v] = INF;
+            touched[s].clear();
+        }
+        settledCount = 0;
+
+        dist[0][source] = 0;
+        dist[1][target] = 0;
+        touched[0].push_back(source);
+        touched[1].push_back(target);
+        heap[0].assign(1, {0, source});
+        heap[1].assign(1, {0, target});
+
+        int best = INF;
+        while (!heap[0].empty() || !heap[1].empty()) {
+            for (int side = 0; side < 2; side++) {
+                auto& pq = heap[side];
+                if (pq.empty()) continue;
+                std::pop_heap(pq.begin(), pq.end(), std::greater<>());
+                auto [d, u] = pq.back();
+                pq.pop_back();
+
+                // Upward search from either side can stop once it cannot improve best
+                if (d >= best) {
+                    pq.clear();
+                    continue;
+                }
+                if (d > dist[side][u]) continue;
+                settledCount++;
+
+                if (dist[1 - side][u] != INF) best = std::min(best, d + dist[1 - side][u]);
+
+                // Stall-on-demand: u is not on a shortest up-down path if a higher
+                // neighbour already reaches it more cheaply
+                bool stalled = false;
+                for (int e = upOffset[u]; e < upOffset[u + 1] && !stalled; e++) {
+                    int via = dist[side][upEdges[e].dest];
+                    stalled = via != INF && via + upEdges[e].weight < d;
+                }
+                if (stalled) continue;
+
+                for (int e = upOffset[u]; e < upOffset[u + 1]; e++) {
+                    int v = upEdges[e].dest;
+                    int nd = d + upEdges[e].weight;
+                    if (nd < dist[side][v]) {
+                        if (dist[side][v] == INF) touched[side].push_back(v);
+                        dist[side][v] = nd;
+                        pq.push_back({nd, v});
+                        std::push_heap(pq.begin(), pq.end(), std::greater<>());
+                    }
+                }
+            }
+        }
+        return best;
+    }
+};
+
+// Fixed team of threads for short parallel phases. run(task) calls task(id) on
+// every thread, the caller being thread 0, and returns once all of them finish.
+class WorkerPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+    std::function<void(int)> task;
+    long long generation;
+    int running;
+    bool stopping;
+
+    void loop(int id) {
+        long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                startCv.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            task(id);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--running == 0) doneCv.notify_one();
+            }
+        }
+    }
+
+public:
+    explicit WorkerPool(int threads) : generation(0), running(0), stopping(false) {
+        for (int id = 1; id < threads; id++) {
+            workers.emplace_back(&WorkerPool::loop, this, id);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        startCv.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    int size() const {
+        return workers.size() + 1;
+    }
+
+    void run(const std::function<void(int)>& f) {
+        if (workers.empty()) {
+            f(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = f;
+            running = workers.size();
+            generation++;
+        }
+        startCv.notify_all();
+        f(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCv.wait(lock, [&]() { return running == 0; });
+    }
+};
+
+// Lower target to value, true if this call made it smaller
+inline bool atomicMin(std::atomic<int>& target, int value) {
+    int current = target.load(std::memory_order_relaxed);
+    while (value < current) {
+        if (target.compare_exchange_weak(current, value, std::memory_order_relaxed)) return true;
+    }
+    return false;
+}
+
+// Delta-stepping single-source shortest paths.
+// Vertices are kept in buckets of width delta. Light edges (weight <= delta) of the
+// current bucket are relaxed in parallel rounds until it stops changing, then heavy
+// edges of every vertex settled in it are relaxed once. Threads lower distances with
+// an atomic min and collect improved vertices in their own lists, which are merged
+// into the buckets between rounds. Gives the same distances as dijkstra.
+std::vector<int> deltaStepping(const std::vector<std::vector<Edge>>& graph, int source, int delta, WorkerPool& pool) {
+    const int INF = std::numeric_limits<int>::max();
+    const size_t CHUNK = 64;
+    int V = graph.size();
+    int threads = pool.size();
+
+    // CSR copy of the graph with the light edges of every vertex first
+    std::vector<int> offset(V + 1, 0);
+    for (int u = 0; u < V; u++) offset[u + 1] = offset[u] + graph[u].size();
+    std::vector<Edge> edges(offset[V]);
+    std::vector<int> lightEnd(V);
+    std::vector<std::atomic<int>> dist(V);
+
+    pool.run([&](int id) {
+        for (int u = (long long)V * id / threads; u < (long long)V * (id + 1) / threads; u++) {
+            int light = offset[u], heavy = offset[u + 1];
+            for (const Edge& edge : graph[u]) {
+                if (edge.weight <= delta) edges[light++] = edge;
+                else edges[--heavy] = edge;
+            }
+            lightEnd[u] = light;
+            dist[u].store(INF, std::memory_order_relaxed);
+        }
+    });
+    dist[source].store(0, std::memory_order_relaxed);
+
+    std::vector<std::vector<int>> buckets(1, std::vector<int>{source});
+    std::vector<std::vector<int>> requests(threads);
+    std::vector<int> frontierStamp(V, -1);
+    std::vector<int> settledStamp(V, -1);
+    std::vector<int> current, frontier, settled;
+    std::atomic<size_t> next(0);
+    int round = 0;
+
+    auto relax = [&](const std::vector<int>& vertices, bool light) {
+        next.store(0);
+        pool.run([&](int id) {
+            auto& improved = requests[id];
+            for (size_t begin = next.fetch_add(CHUNK); begin < vertices.size(); begin = next.fetch_add(CHUNK)) {
+                size_t end = std::min(begin + CHUNK, vertices.size());
+                for (size_t i = begin; i < end; i++) {
+                    int u = vertices[i];
+                    int du = dist[u].load(std::memory_order_relaxed);
+                    int from = light ? offset[u] : lightEnd[u];
+                    int to = light ? lightEnd[u] : offset[u + 1];
+                    for (int e = from; e < to; e++) {
+                        if (atomicMin(dist[edges[e].dest], du + edges[e].weight)) {
+                            improved.push_back(edges[e].dest);
+                        }
+                    }
+                }
+            }
+        });
+
+        for (auto& improved : requests) {
+            for (int v : improved) {
+                size_t b = dist[v].load(std::memory_order_relaxed) / delta;
+                if (b >= buckets.size()) buckets.resize(b + 1);
+                buckets[b].push_back(v);
+            }
+            improved.clear();
+        }
+    };
+
+    for (size_t i = 0; i < buckets.size(); i++) {
+        settled.clear();
+        while (!buckets[i].empty()) {
+            current.swap(buckets[i]);
+            buckets[i].clear();
+            frontier.clear();
+            round++;
+
+            // Skip stale entries (vertex has moved to an earlier bucket) and duplicates
+            for (int v : current) {
+                if ((size_t)(dist[v].load(std::memory_order_relaxed) / delta) != i) continue;
+                if (frontierStamp[v] == round) continue;
+                frontierStamp[v] = round;
+                frontier.push_back(v);
+                if (settledStamp[v] != (int)i) {
+                    settledStamp[v] = i;
+                    settled.push_back(v);
+                }
+            }
+            relax(frontier, true);
+        }
+        relax(settled, false);
+    }
+
+    std::vector<int> result(V);
+    for (int v = 0; v < V; v++) result[v] = dist[v].load(std::memory_order_relaxed);
+    return result;
+}
+
+// Single-source shortest paths kept up to date under edge updates (Ramalingam-Reps style).
+// Decreases and insertions relax outwards from the improved endpoint only.
+// Increases and deletions of a tree edge invalidate the subtree hanging below it;
+// those vertices are reseeded from their unaffected neighbours and repaired with
+// a Dijkstra run that never leaves the affected region by more than one edge.
+class DynamicSSSP {
+private:
+    static constexpr int INF = std::numeric_limits<int>::max();
+
+    std::vector<std::vector<Edge>> adj;
+    int source;
+    std::vector<int> dist;
+    std::vector<int> parent;
+
+    // Workspace reused between updates
+    std::vector<std::pair<int,int>> heap;
+    std::vector<int> affectedStamp;
+    std::vector<int> affected;
+    int stamp;
+    int touchedCount;
+
+    // Index of the edge u -> v in adj[u], -1 if absent
+    int findEdge(int u, int v) const {
+        for (size_t i = 0; i < adj[u].size(); i++) {
+            if (adj[u][i].dest == v) return i;
+        }
+        return -1;
+    }
+
+    void push(int d, int v) {
+        heap.push_back({d, v});
+        std::push_heap(heap.begin(), heap.end(), std::greater<>());
+    }
+
+    // Dijkstra from the vertices already in the heap
+    void propagate() {
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+            auto [d, u] = heap.back();
+            heap.pop_back();
+            if (d > dist[u]) continue;
+            touchedCount++;
+
+            for (const Edge& edge : adj[u]) {
+                if (d + edge.weight < dist[edge.dest]) {
+                    dist[edge.dest] = d + edge.weight;
+                    parent[edge.dest] = u;
+                    push(dist[edge.dest], edge.dest);
+                }
+            }
+        }
+    }
+
+    void tryImprove(int u, int v, int weight) {
+        if (dist[u] == INF || dist[u] + weight >= dist[v]) return;
+        dist[v] = dist[u] + weight;
+        parent[v] = u;
+        push(dist[v], v);
+        propagate();
+    }
+
+    // Recompute the shortest-path subtree rooted at child after its parent edge got worse
+    void repairSubtree(int child) {
+        stamp++;
+        affected.clear();
+        affected.push_back(child);
+        affectedStamp[child] = stamp;
+        for (size_t i = 0; i < affected.size(); i++) {
+            int x = affected[i];
+            for (const Edge& edge : adj[x]) {
+                int y = edge.dest;
+                if (parent[y] == x && affectedStamp[y] != stamp) {
+                    affectedStamp[y] = stamp;
+                    affected.push_back(y);
+                }
+            }
+        }
+
+        for (int x : affected) {
+            dist[x] = INF;
+            parent[x] = -1;
+        }
+        for (int x : affected) {
+            for (const Edge& edge : adj[x]) {
+                int y = edge.dest;
+                if (affectedStamp[y] == stamp || dist[y] == INF) continue;
+                if (dist[y] + edge.weight < dist[x]) {
+                    dist[x] = dist[y] + edge.weight;
+                    parent[x] = y;
+                }
+            }
+            if (dist[x] != INF) push(dist[x], x);
+        }
+        propagate();
+    }
+
+public:
+    DynamicSSSP(const std::vector<std::vector<Edge>>& graph, int start)
+        : adj(graph), source(start), dist(graph.size(), INF), parent(graph.size(), -1),
+          affectedStamp(graph.size(), 0), stamp(0), touchedCount(0) {
+        dist[source] = 0;
+        push(0, source);
+        propagate();
+    }
+
+    // Insert the undirected edge u-v or change its weight
+    void updateEdge(int u, int v, int weight) {
+        if (u == v) return;
+        int iu = findEdge(u, v);
+        int old = iu == -1 ? INF : adj[u][iu].weight;
+        if (iu == -1) {
+            adj[u].push_back({v, weight});
+            adj[v].push_back({u, weight});
+        } else {
+            adj[u][iu].weight = weight;
+            adj[v][findEdge(v, u)].weight = weight;
+        }
+        touchedCount = 0;
+
+        if (weight < old) {
+            tryImprove(u, v, weight);
+            tryImprove(v, u, weight);
+        } else if (weight > old) {
+            if (parent[v] == u) repairSubtree(v);
+            else if (parent[u] == v) repairSubtree(u);
+        }
+    }
+
+    // Remove the undirected edge u-v if present
+    void removeEdge(int u, int v) {
+        int iu = findEdge(u, v);
+        if (iu == -1) return;
+        adj[u].erase(adj[u].begin() + iu);
+        adj[v].erase(adj[v].begin() + findEdge(v, u));
+        touchedCount = 0;
+
+        if (parent[v] == u) repairSubtree(v);
+        else if (parent[u] == v) repairSubtree(u);
+    }
+
+    const std::vector<int>& distances() const {
+        return dist;
+    }
+
+    int parentOf(int v) const {
+        return parent[v];
+    }
+
+    const std::vector<std::vector<Edge>>& graph() const {
+        return adj;
+    }
+
+    // Vertices settled while handling the last update
+    int lastTouched() const {
+        return touchedCount;
+    }
+};
+
+// Compare full Dijkstra with the point-to-point queries on random source-target pairs
+void benchmarkPointToPoint(std::ofstream& outFile, const std::vector<int>& verticesCounts,
+                           const std::vector<int>& minConnectionsCounts, unsigned seed) {
+    const int NUM_QUERIES = 200;
+    const int NUM_LANDMARKS = 4;
+    std::mt19937 gen(seed);
+
+    outFile << "\nPoint-to-point queries (" << NUM_QUERIES << " random pairs per graph):\n";
+    outFile << "Vertices\tAlgorithm\tAvg settled\tAvg latency (us)\n";
+
+    for (size_t i = 0; i < verticesCounts.size(); i++) {
+        int vertices = verticesCounts[i];
+        auto graph = generateConnectedWeightedGraph(vertices, minConnectionsCounts[i], seed + i);
+        LandmarkHeuristic landmarks(graph, NUM_LANDMARKS, gen);
+
+        std::uniform_int_distribution<> vertexDist(0, vertices - 1);
+        std::vector<std::pair<int,int>> queries(NUM_QUERIES);
+        for (auto& q : queries) {
+            q = {vertexDist(gen), vertexDist(gen)};
+        }
+
+        // Reference answers from the full single-source run
+        std::vector<int> expected(NUM_QUERIES);
+        long long fullSettled = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int q = 0; q < NUM_QUERIES; q++) {
+            auto dist = dijkstra(graph, queries[q].first);
+            expected[q] = dist[queries[q].second];
+            for (int d : dist) {
+                if (d != std::numeric_limits<int>::max()) fullSettled++;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double fullTime = std::chrono::duration<double, std::micro>(end - start).count();
+
+        auto runQueries = [&](const char* name, auto query) {
+            long long settled = 0;
+            int mismatches = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int q = 0; q < NUM_QUERIES; q++) {
+                PathResult r = query(queries[q].first, queries[q].second);
+                settled += r.settled;
+                if (r.distance != expected[q]) mismatches++;
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            double time = std::chrono::duration<double, std::micro>(end - start).count();
+
+            outFile << vertices << "\t\t" << name << "\t"
+                    << (double)settled / NUM_QUERIES << "\t\t"
+                    << time / NUM_QUERIES << "\n";
+            if (mismatches) {
+                outFile << "WARNING: " << name << " disagrees with dijkstra on " << mismatches << " queries\n";
+            }
+        };
+
+        outFile << vertices << "\t\tDijkstra\t" << (double)fullSettled / NUM_QUERIES << "\t\t"
+                << fullTime / NUM_QUERIES << "\n";
+        runQueries("Bidirectional", [&](int s, int t) { return bidirectionalDijkstra(graph, s, t); });
+        runQueries("A* (zero)", [&](int s, int t) { return aStar(graph, s, t, ZeroHeuristic{}); });
+        runQueries("A* (ALT)", [&](int s, int t) { return aStar(graph, s, t, landmarks); });
+    }
+}
+
+// Time the generator on large sparse graphs and check that they are connected
+void benchmarkGenerator(std::ofstream& outFile, unsigned seed) {
+    std::vector<int> verticesCounts = {10000, 100000, 1000000};
+    const int MIN_CONNECTIONS = 4;
+
+    outFile << "\nGraph generation (minimum " << MIN_CONNECTIONS << " connections per vertex):\n";
+    outFile << "Vertices\tEdges\t\tTime (ms)\tConnected\n";
+
+    for (int vertices : verticesCounts) {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto graph = generateConnectedWeightedGraph(vertices, MIN_CONNECTIONS, seed);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+        long long edges = 0;
+        for (const auto& adj : graph) edges += adj.size();
+        edges /= 2;
+
+        auto dist = dijkstra(graph, 0);
+        bool connected = std::find(dist.begin(), dist.end(), std::numeric_limits<int>::max()) == dist.end();
+
+        outFile << vertices << "\t\t" << edges << "\t\t" << duration << "\t\t"
+                << (connected ? "yes" : "no") << "\n";
+    }
+}
+
+// Repeated Dijkstra against blocked Floyd-Warshall over a range of densities
+void benchmarkApsp(std::ofstream& outFile, unsigned seed) {
+    std::vector<int> verticesCounts = {128, 256, 512, 1024};
+    std::vector<int> degrees = {2, 4, 8, 16, 32, 64, 128};
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const ApspCostModel& model = apspCostModel();
+    outFile << "\nAll-pairs shortest paths (" << threads << " threads):\n";
+    outFile << "Measured cost model (ns): heap " << model.dijkstraHeapCost << ", arc " << model.dijkstraArcCost
+            << ", FW cell uint16 " << model.fwCellCost16 << ", int32 " << model.fwCellCost32 << "\n";
+    outFile << "Vertices\tDegree\tAvg degree\tDijkstra (ms)\tFW int32 (ms)\tFW uint16 (ms)\tAuto picks\n";
+
+    for (int vertices : verticesCounts) {
+        for (int degree : degrees) {
+            if (degree >= vertices) continue;
+            auto graph = generateConnectedWeightedGraph(vertices, degree, seed + vertices + degree);
+
+            auto time = [](auto run) {
+                auto start = std::chrono::high_resolution_clock::now();
+                auto result = run();
+                auto end = std::chrono::high_resolution_clock::now();
+                return std::make_pair(std::chrono::duration<double, std::milli>(end - start).count(), result);
+            };
+
+            auto [dijkstraTime, expected] = time([&]() { return allPairsShortestPaths(graph, ApspMethod::Dijkstra); });
+            auto [fw32Time, fw32] = time([&]() { return floydWarshall<int32_t>(graph, threads); });
+            auto [fw16Time, fw16] = time([&]() { return floydWarshall<uint16_t>(graph, threads); });
+
+            long long arcs = 0;
+            int maxWeight = 0;
+            for (const auto& edges : graph) {
+                arcs += edges.size();
+                for (const Edge& edge : edges) maxWeight = std::max(maxWeight, edge.weight);
+            }
+            bool dense = preferFloydWarshall(vertices, arcs, maxWeight, threads);
+
+            outFile << vertices << "\t\t" << degree << "\t" << (double)arcs / vertices << "\t\t" << dijkstraTime << "\t\t"
+                    << fw32Time << "\t\t" << fw16Time << "\t\t"
+                    << (dense ? "Floyd-Warshall" : "Dijkstra") << "\n";
+            if (fw32 != expected || fw16 != expected) {
+                outFile << "WARNING: Floyd-Warshall disagrees with dijkstra\n";
+            }
+        }
+    }
+}
+
+// Contraction hierarchy preprocessing cost and query latency against plain Dijkstra,
+// on random graphs (hard for contraction) and grids (road-like)
+void benchmarkContractionHierarchy(std::ofstream& outFile, unsigned seed) {
+    const int NUM_QUERIES = 1000;
+    const int NUM_DIJKSTRA_QUERIES = 50;
+    std::mt19937 gen(seed);
+
+    std::vector<std::pair<std::string, std::vector<std::vector<Edge>>>> cases;
+    cases.push_back({"Random 1000 x2", generateConnectedWeightedGraph(1000, 2, seed)});
+    cases.push_back({"Random 5000 x2", generateConnectedWeightedGraph(5000, 2, seed)});
+    cases.push_back({"Grid 100x100", generateGridGraph(100, 100, seed)});
+    cases.push_back({"Grid 300x300", generateGridGraph(300, 300, seed)});
+
+    outFile << "\nContraction hierarchy:\n";
+    outFile << "Graph\t\tEdges\tPreprocess (ms)\tShortcuts\tCH query (us)\tCH settled\tDijkstra query (us)\n";
+
+    for (const auto& [name, graph] : cases) {
+        int vertices = graph.size();
+        long long edges = 0;
+        for (const auto& adj : graph) edges += adj.size();
+        edges /= 2;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ContractionHierarchy ch(graph);
+        auto end = std::chrono::high_resolution_clock::now();
+        double preprocessTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::uniform_int_distribution<> vertexDist(0, vertices - 1);
+        std::vector<std::pair<int,int>> queries(NUM_QUERIES);
+        for (auto& q : queries) {
+            q = {vertexDist(gen), vertexDist(gen)};
+        }
+
+        std::vector<int> answers(NUM_QUERIES);
+        long long settled = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (int q = 0; q < NUM_QUERIES; q++) {
+            answers[q] = ch.query(queries[q].first, queries[q].second);
+            settled += ch.lastSettled();
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double chTime = std::chrono::duration<double, std::micro>(end - start).count() / NUM_QUERIES;
+
+        int mismatches = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (int q = 0; q < NUM_DIJKSTRA_QUERIES; q++) {
+            if (dijkstra(graph, queries[q].first)[queries[q].second] != answers[q]) mismatches++;
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double dijkstraTime = std::chrono::duration<double, std::micro>(end - start).count() / NUM_DIJKSTRA_QUERIES;
+
+        outFile << name << "\t" << edges << "\t" << preprocessTime << "\t\t" << ch.shortcutCount() << "\t\t"
+                << chTime << "\t\t" << (double)settled / NUM_QUERIES << "\t\t" << dijkstraTime << "\n";
+        if (mismatches) {
+            outFile << "WARNING: contraction hierarchy disagrees with dijkstra on " << mismatches << " queries\n";
+        }
+    }
+}
+
+// Delta-stepping over a sweep of delta and thread counts, checked against dijkstra
+void benchmarkDeltaStepping(std::ofstream& outFile, unsigned seed) {
+    std::vector<std::pair<int,int>> configs = {{100000, 10}, {1000000, 16}}; // vertices, min connections
+    std::vector<int> deltas = {1, 5, 10, 20, 50};
+    std::vector<int> threadCounts;
+    int hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (int t = 1; t < hardware; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(hardware);
+
+    outFile << "\nDelta-stepping SSSP:\n";
+    outFile << "Vertices\tEdges\t\tDelta\tThreads\tTime (ms)\tDijkstra (ms)\tMatches\n";
+
+    for (const auto& [vertices, minConnections] : configs) {
+        auto graph = generateConnectedWeightedGraph(vertices, minConnections, seed + vertices);
+        long long edges = 0;
+        for (const auto& adj : graph) edges += adj.size();
+        edges /= 2;
+        int source = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto expected = dijkstra(graph, source);
+        auto end = std::chrono::high_resolution_clock::now();
+        double dijkstraTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        for (int threads : threadCounts) {
+            WorkerPool pool(threads);
+            for (int delta : deltas) {
+                start = std::chrono::high_resolution_clock::now();
+                auto dist = deltaStepping(graph, source, delta, pool);
+                end = std::chrono::high_resolution_clock::now();
+                double time = std::chrono::duration<double, std::milli>(end - start).count();
+
+                outFile << vertices << "\t\t" << edges << "\t" << delta << "\t" << threads << "\t"
+                        << time << "\t\t" << dijkstraTime << "\t\t" << (dist == expected ? "yes" : "no") << "\n";
+            }
+        }
+    }
+}
+
+// Update throughput of DynamicSSSP against rerunning dijkstra after every update
+void benchmarkDynamicSSSP(std::ofstream& outFile, unsigned seed) {
+    std::vector<int> verticesCounts = {10000, 100000};
+    const int MIN_CONNECTIONS = 4;
+    const int NUM_UPDATES = 20000;
+    const int NUM_RECOMPUTES = 20;
+    const char* typeNames[] = {"Decrease", "Insert", "Increase", "Delete"};
+    std::mt19937 gen(seed);
+
+    outFile << "\nDynamic SSSP (" << NUM_UPDATES << " updates, 40% decrease, 20% insert, 30% increase, 10% delete):\n";
+    outFile << "Vertices\tUpdate\t\tUpdates/s\tAvg settled\tRecompute updates/s\n";
+
+    for (int vertices : verticesCounts) {
+        auto graph = generateConnectedWeightedGraph(vertices, MIN_CONNECTIONS, seed + vertices);
+        DynamicSSSP sssp(graph, 0);
+
+        std::uniform_int_distribution<> vertexDist(0, vertices - 1);
+        std::uniform_int_distribution<> weightDist(1, 20);
+        std::uniform_int_distribution<> typeDist(0, 9);
+
+        double time[4] = {0, 0, 0, 0};
+        long long count[4] = {0, 0, 0, 0};
+        long long settled[4] = {0, 0, 0, 0};
+
+        for (int i = 0; i < NUM_UPDATES; i++) {
+            int roll = typeDist(gen);
+            int type = roll < 4 ? 0 : roll < 6 ? 1 : roll < 9 ? 2 : 3;
+
+            // Pick an existing edge for everything but insertions
+            int u = vertexDist(gen);
+            int v = vertexDist(gen);
+            int weight = weightDist(gen);
+            const auto& edges = sssp.graph()[u];
+            if (type != 1) {
+                if (edges.empty()) continue;
+                const Edge& edge = edges[std::uniform_int_distribution<>(0, edges.size() - 1)(gen)];
+                v = edge.dest;
+                if (type == 0) weight = std::max(1, edge.weight / 2);
+                if (type == 2) weight = edge.weight + weightDist(gen);
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            if (type == 3) sssp.removeEdge(u, v);
+            else sssp.updateEdge(u, v, weight);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            time[type] += std::chrono::duration<double>(end - start).count();
+            count[type]++;
+            settled[type] += sssp.lastTouched();
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<int> expected;
+        for (int i = 0; i < NUM_RECOMPUTES; i++) {
+            expected = dijkstra(sssp.graph(), 0);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double recomputeRate = NUM_RECOMPUTES / std::chrono::duration<double>(end - start).count();
+
+        for (int type = 0; type < 4; type++) {
+            outFile << vertices << "\t\t" << typeNames[type] << "\t"
+                    << (time[type] > 0 ? count[type] / time[type] : 0) << "\t\t"
+                    << (count[type] ? (double)settled[type] / count[type] : 0) << "\t\t"
+                    << recomputeRate << "\n";
+        }
+        if (sssp.distances() != expected) {
+            outFile << "WARNING: dynamic distances disagree with dijkstra\n";
+        }
+    }
+}
+
+// Per-source Dijkstra time with the AoS adjacency lists and with the SoA CSR layout
+void benchmarkCSRLayout(std::ofstream& outFile, unsigned seed) {
+    std::vector<std::pair<int,int>> configs = {{2000, 64}, {5000, 128}, {10000, 256}}; // vertices, min connections
+    const int NUM_SOURCES = 20;
+
+    outFile << "\nDijkstra edge layout (per source):\n";
+    outFile << "Vertices\tAvg degree\tAoS lists (us)\tSoA CSR (us)\tMatches\n";
+
+    for (const auto& [vertices, minConnections] : configs) {
+        auto graph = generateConnectedWeightedGraph(vertices, minConnections, seed + vertices);
+        WeightedCSR csr(graph);
+        long long arcs = 0;
+        for (const auto& edges : graph) arcs += edges.size();
+
+        bool matches = true;
+        double listTime = 0, csrTime = 0;
+        for (int source = 0; source < NUM_SOURCES; source++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            auto expected = dijkstra(graph, source);
+            auto mid = std::chrono::high_resolution_clock::now();
+            auto dist = dijkstraCSR(csr, source);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            listTime += std::chrono::duration<double, std::micro>(mid - start).count();
+            csrTime += std::chrono::duration<double, std::micro>(end - mid).count();
+            matches = matches && dist == expected;
         }
-        std::shuffle(possibleConnections.begin(), possibleConnections.end(), gen);
-        
-        int connections = connectionDist(gen);
-        for (int j = 0; j < std::min(connections, (int)possibleConnections.size()); j++) {
-            int dest = possibleConnections[j];
-            int weight = weightDist(gen);
-            graph[i].push_back({dest, weight});
-            graph[dest].push_back({i, weight}); // Undirected graph
+
+        outFile << vertices << "\t\t" << (double)arcs / vertices << "\t\t" << listTime / NUM_SOURCES << "\t\t"
+                << csrTime / NUM_SOURCES << "\t\t" << (matches ? "yes" : "no") << "\n";
+    }
+}
+
+// All-pairs distance store in a memory-mapped file.
+// Layout: ApspHeader, rows back to back, then one ApspRowIndex per source at indexOffset.
+// A raw row holds V distances of the header width, unreachable being the all-ones value.
+// A delta row holds V signed int8/int16 differences against an earlier raw row (its base);
+// by the triangle inequality they are bounded by the distance between the two sources,
+// so rows of nearby sources written one after another compress well. Both kinds of row
+// support O(1) lookups straight from the mapping.
+struct ApspHeader {
+    char magic[4];        // "APSP"
+    uint32_t version;
+    uint32_t vertices;
+    uint32_t width;       // bytes per raw distance: 1, 2 or 4
+    uint64_t indexOffset;
+};
+
+struct ApspRowIndex {
+    uint64_t offset;      // UINT64_MAX if the row was never written
+    uint32_t base;        // raw row the deltas refer to
+    uint32_t deltaWidth;  // 0 for a raw row, else bytes per delta
+};
+
+// Narrowest width whose all-ones sentinel is above maxDistance
+uint32_t distanceWidth(long long maxDistance) {
+    if (maxDistance < 0xFF) return 1;
+    if (maxDistance < 0xFFFF) return 2;
+    return 4;
+}
+
+// Writes rows in any order as they are produced, then the index on finish()
+class ApspStoreWriter {
+private:
+    std::string path;
+    std::ofstream file;
+    BufferedWriter writer;
+    ApspHeader header;
+    std::vector<ApspRowIndex> index;
+    uint64_t offset;
+    int anchor;                 // last raw row, base for the following delta rows
+    std::vector<int> anchorRow;
+    int deltaRows;
+    bool finished;
+
+    void writeValue(long long value, uint32_t width) {
+        if (width == 1) writer.writeRaw<uint8_t>(value);
+        else if (width == 2) writer.writeRaw<uint16_t>(value);
+        else writer.writeRaw<uint32_t>(value);
+        offset += width;
+    }
+
+public:
+    ApspStoreWriter(const std::string& path, int vertices, long long maxDistance)
+        : path(path), file(path, std::ios::binary), writer(file), header{{'A', 'P', 'S', 'P'}, 1, (uint32_t)vertices,
+          distanceWidth(maxDistance), 0}, index(vertices, {UINT64_MAX, 0, 0}), offset(sizeof(ApspHeader)),
+          anchor(-1), deltaRows(0), finished(false) {
+        if (!file) throw std::runtime_error("Failed to open " + path);
+        writer.writeRaw(header);
+    }
+
+    // A store that was never finished (an exception left writing) is deleted
+    // rather than completed, so it cannot be mistaken for a whole one
+    ~ApspStoreWriter() {
+        if (finished) return;
+        file.close();
+        std::remove(path.c_str());
+    }
+
+    void writeRow(int source, const std::vector<int>& dist) {
+        const int INF = std::numeric_limits<int>::max();
+        uint32_t width = header.width;
+        long long sentinel = width == 4 ? 0xFFFFFFFFLL : (1LL << (8 * width)) - 1;
+
+        // Largest difference to the anchor row, or -1 if either row has unreachable entries
+        long long maxDelta = anchor == -1 ? -1 : 0;
+        for (size_t v = 0; v < dist.size() && maxDelta >= 0; v++) {
+            if (dist[v] == INF || anchorRow[v] == INF) maxDelta = -1;
+            else maxDelta = std::max<long long>(maxDelta, std::abs((long long)dist[v] - anchorRow[v]));
+        }
+        uint32_t deltaWidth = maxDelta < 0 ? 0 : maxDelta <= 0x7F ? 1 : maxDelta <= 0x7FFF ? 2 : 0;
+
+        if (deltaWidth && deltaWidth < width) {
+            index[source] = {offset, (uint32_t)anchor, deltaWidth};
+            for (size_t v = 0; v < dist.size(); v++) {
+                writeValue(dist[v] - anchorRow[v], deltaWidth);
+            }
+            deltaRows++;
+            return;
+        }
+
+        index[source] = {offset, (uint32_t)source, 0};
+        for (int d : dist) {
+            if (d != INF && d >= sentinel) throw std::runtime_error("distance does not fit the store width");
+            writeValue(d == INF ? sentinel : d, width);
         }
+        anchor = source;
+        anchorRow = dist;
     }
-    
-    return graph;
+
+    void finish() {
+        header.indexOffset = offset;
+        for (const auto& entry : index) writer.writeRaw(entry);
+        writer.flush();
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.close();
+        if (!file) throw std::runtime_error("Failed to write " + path);
+        finished = true;
+    }
+
+    int deltaRowCount() const {
+        return deltaRows;
+    }
+
+    uint32_t width() const {
+        return header.width;
+    }
+};
+
+// Read-only view of a store written by ApspStoreWriter
+class ApspStore {
+private:
+    int fd;
+    const char* data;
+    size_t size;
+    ApspHeader header;
+    const char* index;
+    long long sentinel;
+
+    template<typename U>
+    U read(uint64_t at) const {
+        U value;
+        std::memcpy(&value, data + at, sizeof(U));
+        return value;
+    }
+
+    ApspRowIndex rowIndex(int u) const {
+        return read<ApspRowIndex>(header.indexOffset + (uint64_t)u * sizeof(ApspRowIndex));
+    }
+
+public:
+    explicit ApspStore(const std::string& path) : fd(-1), data(nullptr), size(0) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Failed to open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ApspHeader)) {
+            ::close(fd);
+            throw std::runtime_error("Not an APSP store: " + path);
+        }
+        size = st.st_size;
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("mmap failed for " + path);
+        }
+        data = static_cast<const char*>(mapping);
+        header = read<ApspHeader>(0);
+        if (std::memcmp(header.magic, "APSP", 4) != 0 || header.version != 1 ||
+            header.indexOffset + (uint64_t)header.vertices * sizeof(ApspRowIndex) > size) {
+            ::munmap(mapping, size);
+            ::close(fd);
+            throw std::runtime_error("Not an APSP store: " + path);
+        }
+        index = data + header.indexOffset;
+        sentinel = header.width == 4 ? 0xFFFFFFFFLL : (1LL << (8 * header.width)) - 1;
+    }
+
+    ~ApspStore() {
+        ::munmap(const_cast<char*>(data), size);
+        ::close(fd);
+    }
+
+    ApspStore(const ApspStore&) = delete;
+    ApspStore& operator=(const ApspStore&) = delete;
+
+    int vertexCount() const {
+        return header.vertices;
+    }
+
+    // Distance from u to v, int max if unreachable
+    int distance(int u, int v) const {
+        ApspRowIndex row = rowIndex(u);
+        if (row.offset == UINT64_MAX) throw std::runtime_error("row not stored");
+
+        if (row.deltaWidth) {
+            int base = distance(row.base, v);
+            uint64_t at = row.offset + (uint64_t)v * row.deltaWidth;
+            return base + (row.deltaWidth == 1 ? read<int8_t>(at) : read<int16_t>(at));
+        }
+
+        uint64_t at = row.offset + (uint64_t)v * header.width;
+        long long value = header.width == 1 ? read<uint8_t>(at) : header.width == 2 ? read<uint16_t>(at) : read<uint32_t>(at);
+        return value == sentinel ? std::numeric_limits<int>::max() : value;
+    }
+};
+
+// Run Dijkstra from every source and stream the rows into a store at path.
+// Sources go in BFS order so consecutive rows are close and delta-encode well.
+// On an undirected connected graph twice the eccentricity of vertex 0 bounds every distance.
+void writeApspStore(const std::vector<std::vector<Edge>>& graph, const std::string& path,
+                    uint32_t* widthOut = nullptr, int* deltaRowsOut = nullptr) {
+    const int INF = std::numeric_limits<int>::max();
+    int V = graph.size();
+
+    auto first = dijkstra(graph, 0);
+    long long bound = 0;
+    bool connected = true;
+    for (int d : first) {
+        if (d == INF) connected = false;
+        else bound = std::max<long long>(bound, d);
+    }
+    if (!connected) {
+        int maxWeight = 0;
+        for (const auto& edges : graph) {
+            for (const Edge& edge : edges) maxWeight = std::max(maxWeight, edge.weight);
+        }
+        bound = (long long)maxWeight * std::max(V - 1, 0);
+    } else {
+        bound *= 2;
+    }
+
+    std::vector<int> order;
+    std::vector<char> seen(V, 0);
+    for (int root = 0; root < V; root++) {
+        if (seen[root]) continue;
+        seen[root] = 1;
+        order.push_back(root);
+        for (size_t i = order.size() - 1; i < order.size(); i++) {
+            for (const Edge& edge : graph[order[i]]) {
+                if (!seen[edge.dest]) {
+                    seen[edge.dest] = 1;
+                    order.push_back(edge.dest);
+                }
+            }
+        }
+    }
+
+    ApspStoreWriter writer(path, V, bound);
+    for (int source : order) {
+        writer.writeRow(source, source == 0 ? first : dijkstra(graph, source));
+    }
+    writer.finish();
+    if (widthOut) *widthOut = writer.width();
+    if (deltaRowsOut) *deltaRowsOut = writer.deltaRowCount();
 }
 
-// Print adjacency matrix
-void printAdjacencyMatrix(std::ofstream& outFile, const std::vector<std::vector<Edge>>& graph) {
-    outFile << "Adjacency Matrix:\n";
-    for (int i = 0; i < graph.size(); i++) {
-        for (int j = 0; j < graph.size(); j++) {
-            bool found = false;
-            for (const Edge& edge : graph[i]) {
-                if (edge.dest == j) {
-                    outFile << std::setw(4) << edge.weight;
-                    found = true;
-                    break;
+// Size, build time and lookup latency of the memory-mapped APSP store
+void benchmarkApspStore(std::ofstream& outFile, unsigned seed) {
+    const int NUM_LOOKUPS = 1000000;
+    const int NUM_CHECKED_SOURCES = 20;
+    const std::string path = "apsp_store.bin";
+    std::mt19937 gen(seed);
+
+    std::vector<std::pair<std::string, std::vector<std::vector<Edge>>>> cases;
+    cases.push_back({"Random 2000 x4", generateConnectedWeightedGraph(2000, 4, seed)});
+    cases.push_back({"Random 5000 x4", generateConnectedWeightedGraph(5000, 4, seed)});
+    cases.push_back({"Grid 60x60", generateGridGraph(60, 60, seed)});
+
+    outFile << "\nAPSP result store:\n";
+    outFile << "Graph\t\tWidth\tDelta rows\tFile (MB)\tint matrix (MB)\tWrite (ms)\tLookup (ns)\tMatches\n";
+
+    for (const auto& [name, graph] : cases) {
+        int vertices = graph.size();
+        uint32_t width = 0;
+        int deltaRows = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        writeApspStore(graph, path, &width, &deltaRows);
+        auto end = std::chrono::high_resolution_clock::now();
+        double writeTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        ApspStore store(path);
+        std::ifstream sizeCheck(path, std::ios::binary | std::ios::ate);
+        double fileSize = sizeCheck.tellg() / 1e6;
+
+        std::uniform_int_distribution<> vertexDist(0, vertices - 1);
+        std::vector<std::pair<int,int>> lookups(NUM_LOOKUPS);
+        for (auto& l : lookups) l = {vertexDist(gen), vertexDist(gen)};
+
+        long long checksum = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (const auto& [u, v] : lookups) checksum += store.distance(u, v);
+        end = std::chrono::high_resolution_clock::now();
+        double lookupTime = std::chrono::duration<double, std::nano>(end - start).count() / NUM_LOOKUPS;
+        [[maybe_unused]] volatile long long sink = checksum;
+
+        bool matches = true;
+        for (int i = 0; i < NUM_CHECKED_SOURCES; i++) {
+            int source = vertexDist(gen);
+            auto dist = dijkstra(graph, source);
+            for (int v = 0; v < vertices; v++) {
+                matches = matches && store.distance(source, v) == dist[v];
+            }
+        }
+
+        outFile << name << "\t" << width << "\t" << deltaRows << "/" << vertices << "\t" << fileSize << "\t\t"
+                << (double)vertices * vertices * sizeof(int) / 1e6 << "\t\t" << writeTime << "\t\t"
+                << lookupTime << "\t\t" << (matches ? "yes" : "no") << "\n";
+    }
+    std::remove(path.c_str());
+}
+
+// Integer command-line argument within [low, high]; false if text is not one
+bool parseArgument(const char* text, int low, int high, int& value) {
+    int parsed;
+    const char* end = text + std::strlen(text);
+    auto [ptr, ec] = std::from_chars(text, end, parsed);
+    if (ec != std::errc() || ptr != end || parsed < low || parsed > high) return false;
+    value = parsed;
+    return true;
+}
+
+// Local shortest-path query server.
+// Wire format over a Unix domain stream socket, host byte order (both ends are on one machine):
+//   on connect, server -> client: uint32 vertex count
+//   request:  uint32 count, uint32 flags, then count x (int32 source, int32 target)
+//   response: uint32 number of 32-bit words that follow, then for each query int32 distance
+//             (int max if unreachable, -1 if a vertex is invalid), followed by uint32 length
+//             and length x int32 vertices when QUERY_WANT_PATH is set
+const uint32_t QUERY_WANT_PATH = 1;
+const uint32_t MAX_BATCH = 1 << 20;
+
+// Read exactly length bytes; false on end of stream before the first byte
+bool readAll(int fd, void* data, size_t length) {
+    char* ptr = static_cast<char*>(data);
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::read(fd, ptr + done, length - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::runtime_error(std::string("read failed: ") + std::strerror(errno));
+        if (n == 0) {
+            if (done == 0) return false;
+            throw std::runtime_error("connection closed mid-message");
+        }
+        done += n;
+    }
+    return true;
+}
+
+// Write all of data to a socket. A peer that has gone away gives EPIPE, which
+// is thrown, rather than SIGPIPE, which would end the process.
+void writeAll(int fd, const void* data, size_t length) {
+    const char* ptr = static_cast<const char*>(data);
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::send(fd, ptr + done, length - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+        done += n;
+    }
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("socket path too long: " + path);
+    std::strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+// Distances and shortest-path tree of one single-source run
+struct SourceResult {
+    std::vector<int> dist;
+    std::vector<int> parent;
+};
+
+// Least-recently-used cache of single-source results, shared by all server workers
+class SourceCache {
+private:
+    size_t capacity;
+    std::mutex mutex;
+    std::list<std::pair<int, std::shared_ptr<const SourceResult>>> order; // most recent first
+    std::unordered_map<int, decltype(order)::iterator> index;
+
+public:
+    explicit SourceCache(size_t size) : capacity(size) {}
+
+    std::shared_ptr<const SourceResult> get(int source) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(source);
+        if (it == index.end()) return nullptr;
+        order.splice(order.begin(), order, it->second);
+        return it->second->second;
+    }
+
+    void put(int source, std::shared_ptr<const SourceResult> result) {
+        if (capacity == 0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(source);
+        if (it != index.end()) {
+            order.erase(it->second);
+            index.erase(it);
+        }
+        order.emplace_front(source, std::move(result));
+        index[source] = order.begin();
+        if (order.size() > capacity) {
+            index.erase(order.back().first);
+            order.pop_back();
+        }
+    }
+};
+
+// Dijkstra with parents on the CSR graph; one per worker thread so the heap storage is reused
+class DijkstraWorkspace {
+private:
+    std::vector<std::pair<int,int>> heap;
+
+public:
+    std::shared_ptr<SourceResult> run(const WeightedCSR& graph, int source) {
+        int V = graph.vertexCount();
+        auto result = std::make_shared<SourceResult>();
+        result->dist.assign(V, std::numeric_limits<int>::max());
+        result->parent.assign(V, -1);
+        auto& dist = result->dist;
+
+        dist[source] = 0;
+        heap.assign(1, {0, source});
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+            auto [d, u] = heap.back();
+            heap.pop_back();
+            if (d > dist[u]) continue;
+
+            for (int e = graph.offset[u]; e < graph.offset[u + 1]; e++) {
+                int v = graph.dest[e];
+                if (d + graph.weight[e] < dist[v]) {
+                    dist[v] = d + graph.weight[e];
+                    result->parent[v] = u;
+                    heap.push_back({dist[v], v});
+                    std::push_heap(heap.begin(), heap.end(), std::greater<>());
+                }
+            }
+        }
+        return result;
+    }
+};
+
+// Answer one request batch on a connection; false once the client has closed it
+bool serveBatch(int fd, const WeightedCSR& graph, SourceCache& cache, DijkstraWorkspace& workspace,
+                std::vector<int32_t>& pairs, std::vector<int32_t>& response) {
+    int V = graph.vertexCount();
+    uint32_t header[2];
+    if (!readAll(fd, header, sizeof(header))) return false;
+    uint32_t count = header[0];
+    bool wantPath = header[1] & QUERY_WANT_PATH;
+    if (count > MAX_BATCH) throw std::runtime_error("batch too large");
+
+    pairs.resize(2 * count);
+    if (count && !readAll(fd, pairs.data(), pairs.size() * sizeof(int32_t))) {
+        throw std::runtime_error("connection closed mid-message");
+    }
+
+    response.assign(1, 0); // word count, filled in below
+    int lastSource = -1;
+    std::shared_ptr<const SourceResult> result;
+    for (uint32_t q = 0; q < count; q++) {
+        int source = pairs[2 * q], target = pairs[2 * q + 1];
+        if (source < 0 || source >= V || target < 0 || target >= V) {
+            response.push_back(-1);
+            if (wantPath) response.push_back(0);
+            continue;
+        }
+
+        if (source != lastSource) {
+            result = cache.get(source);
+            if (!result) {
+                result = workspace.run(graph, source);
+                cache.put(source, result);
+            }
+            lastSource = source;
+        }
+
+        int distance = result->dist[target];
+        response.push_back(distance);
+        if (wantPath) {
+            std::vector<int> path;
+            if (distance != std::numeric_limits<int>::max()) {
+                path = reconstructPath(result->parent, source, target);
+            }
+            response.push_back(path.size());
+            response.insert(response.end(), path.begin(), path.end());
+        }
+    }
+    response[0] = response.size() - 1;
+    writeAll(fd, response.data(), response.size() * sizeof(int32_t));
+    return true;
+}
+
+// Blocking queue of connections that have a request waiting; pop returns -1 once closed
+class ConnectionQueue {
+private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> fds;
+    bool closed = false;
+
+public:
+    void push(int fd) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fds.push_back(fd);
+        }
+        ready.notify_one();
+    }
+
+    int pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this]() { return closed || !fds.empty(); });
+        if (fds.empty()) return -1;
+        int fd = fds.front();
+        fds.pop_front();
+        return fd;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+};
+
+// server <socket path> [vertices] [min connections] [threads] [cache size] [seed]
+int runServer(int argc, char* argv[]) {
+    int vertices = 100000;
+    int minConnections = 4;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int cacheSize = 64;
+    int seed = 12345;
+    if (argc < 3 || argc > 8 ||
+        (argc > 3 && !parseArgument(argv[3], 1, std::numeric_limits<int>::max(), vertices)) ||
+        (argc > 4 && !parseArgument(argv[4], 1, std::numeric_limits<int>::max(), minConnections)) ||
+        (argc > 5 && !parseArgument(argv[5], 1, 1024, threads)) ||
+        (argc > 6 && !parseArgument(argv[6], 0, std::numeric_limits<int>::max(), cacheSize)) ||
+        (argc > 7 && !parseArgument(argv[7], 0, std::numeric_limits<int>::max(), seed))) {
+        std::cerr << "Usage: " << argv[0]
+                  << " server <socket path> [vertices] [min connections] [threads] [cache size] [seed]\n";
+        return 1;
+    }
+    std::string path = argv[2];
+
+    auto start = std::chrono::high_resolution_clock::now();
+    WeightedCSR graph(generateConnectedWeightedGraph(vertices, minConnections, seed));
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cerr << "Loaded graph with " << vertices << " vertices (seed " << seed << ") in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms\n";
+
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "socket failed: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    sockaddr_un addr = socketAddress(path);
+    ::unlink(path.c_str());
+    if (::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listenFd, 128) < 0) {
+        std::cerr << "Failed to listen on " << path << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    int wakePipe[2];
+    if (::pipe(wakePipe) < 0) {
+        std::cerr << "pipe failed: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    std::cerr << "Serving on " << path << " with " << threads << " workers\n";
+
+    // The poll loop accepts every client at once and hands a connection to the
+    // worker queue whenever a request arrives on it. A worker answers one batch
+    // and returns the connection to the poll loop, so clients beyond the worker
+    // count wait in the queue for a batch rather than in the listen backlog
+    // for a whole connection.
+    SourceCache cache(cacheSize);
+    ConnectionQueue pending;
+    std::mutex returnedMutex;
+    std::vector<int> returned;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            DijkstraWorkspace workspace;
+            std::vector<int32_t> pairs;
+            std::vector<int32_t> response;
+            int fd;
+            while ((fd = pending.pop()) >= 0) {
+                bool open = false;
+                try {
+                    open = serveBatch(fd, graph, cache, workspace, pairs, response);
+                } catch (const std::exception& e) {
+                    std::cerr << "Connection error: " << e.what() << "\n";
+                }
+                if (!open) {
+                    ::close(fd);
+                    continue;
                 }
+                {
+                    std::lock_guard<std::mutex> lock(returnedMutex);
+                    returned.push_back(fd);
+                }
+                char wake = 0;
+                while (::write(wakePipe[1], &wake, 1) < 0 && errno == EINTR) {}
+            }
+        });
+    }
+
+    // fds[0] is the listening socket, fds[1] the wake pipe, the rest idle connections
+    std::vector<pollfd> fds = {{listenFd, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+    while (true) {
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "poll failed: " << std::strerror(errno) << "\n";
+            break;
+        }
+
+        size_t idle = 2;
+        for (size_t i = 2; i < fds.size(); i++) {
+            if (fds[i].revents) {
+                pending.push(fds[i].fd);
+            } else {
+                fds[idle++] = fds[i];
+            }
+        }
+        fds.resize(idle);
+
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (::read(wakePipe[0], drain, sizeof(drain)) < 0 && errno == EINTR) {}
+            std::lock_guard<std::mutex> lock(returnedMutex);
+            for (int fd : returned) fds.push_back({fd, POLLIN, 0});
+            returned.clear();
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                std::cerr << "accept failed: " << std::strerror(errno) << "\n";
+                break;
+            }
+            try {
+                uint32_t vertexCount = vertices;
+                writeAll(fd, &vertexCount, sizeof(vertexCount));
+                fds.push_back({fd, POLLIN, 0});
+            } catch (const std::exception& e) {
+                std::cerr << "Connection error: " << e.what() << "\n";
+                ::close(fd);
             }
-            if (!found) outFile << std::setw(4) << "0";
         }
-        outFile << "\n";
     }
-    outFile << "\n";
+
+    pending.close();
+    for (auto& worker : workers) worker.join();
+    for (size_t i = 2; i < fds.size(); i++) ::close(fds[i].fd);
+    ::close(wakePipe[0]);
+    ::close(wakePipe[1]);
+    ::close(listenFd);
+    return 1;
 }
 
-// Dijkstra's algorithm implementation
-std::vector<int> dijkstra(const std::vector<std::vector<Edge>>& graph, int start) {
-    int V = graph.size();
-    std::vector<int> dist(V, std::numeric_limits<int>::max());
-    dist[start] = 0;
-    
-    std::priority_queue<std::pair<int,int>, std::vector<std::pair<int,int>>, std::greater<>> pq;
-    pq.push({0, start});
-    
-    while (!pq.empty()) {
-        int u = pq.top().second;
-        int d = pq.top().first;
-        pq.pop();
-        
-        if (d > dist[u]) continue;
-        
-        for (const Edge& edge : graph[u]) {
-            int v = edge.dest;
-            int weight = edge.weight;
-            
-            if (dist[u] + weight < dist[v]) {
-                dist[v] = dist[u] + weight;
-                pq.push({dist[v], v});
+// client <socket path> [clients] [batches per client] [batch size] [distinct sources] [paths]
+// Load generator: reports per-batch round-trip latency percentiles and queries per second
+int runClient(int argc, char* argv[]) {
+    int clients = 4;
+    int batches = 1000;
+    int batchSize = 16;
+    int distinctSources = 32;
+    int paths = 0;
+    if (argc < 3 || argc > 8 ||
+        (argc > 3 && !parseArgument(argv[3], 1, 1024, clients)) ||
+        (argc > 4 && !parseArgument(argv[4], 1, std::numeric_limits<int>::max(), batches)) ||
+        (argc > 5 && !parseArgument(argv[5], 1, MAX_BATCH, batchSize)) ||
+        (argc > 6 && !parseArgument(argv[6], 1, std::numeric_limits<int>::max(), distinctSources)) ||
+        (argc > 7 && !parseArgument(argv[7], 0, 1, paths))) {
+        std::cerr << "Usage: " << argv[0]
+                  << " client <socket path> [clients] [batches] [batch size] [distinct sources] [paths 0/1]\n";
+        return 1;
+    }
+    std::string path = argv[2];
+    uint32_t flags = paths ? QUERY_WANT_PATH : 0;
+
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<std::string> errors(clients);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back([&, c]() {
+            int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            try {
+                sockaddr_un addr = socketAddress(path);
+                if (fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+                    throw std::runtime_error(std::string("connect failed: ") + std::strerror(errno));
+                }
+                uint32_t vertices;
+                if (!readAll(fd, &vertices, sizeof(vertices))) throw std::runtime_error("server closed connection");
+
+                // Sources come from a small hot set so the server cache has something to hit
+                std::mt19937 gen(c + 1);
+                std::uniform_int_distribution<> vertexDist(0, vertices - 1);
+                if (vertices == 0) throw std::runtime_error("server graph is empty");
+                std::vector<int32_t> hotSources(distinctSources);
+                for (auto& s : hotSources) s = vertexDist(gen);
+                std::uniform_int_distribution<> hotDist(0, hotSources.size() - 1);
+
+                std::vector<int32_t> request(2 + 2 * batchSize);
+                std::vector<int32_t> response;
+                for (int b = 0; b < batches; b++) {
+                    request[0] = batchSize;
+                    request[1] = flags;
+                    for (int q = 0; q < batchSize; q++) {
+                        request[2 + 2 * q] = hotSources[hotDist(gen)];
+                        request[3 + 2 * q] = vertexDist(gen);
+                    }
+
+                    auto sent = std::chrono::high_resolution_clock::now();
+                    writeAll(fd, request.data(), request.size() * sizeof(int32_t));
+                    uint32_t words;
+                    if (!readAll(fd, &words, sizeof(words))) throw std::runtime_error("server closed connection");
+                    response.resize(words);
+                    if (words && !readAll(fd, response.data(), words * sizeof(int32_t))) {
+                        throw std::runtime_error("server closed connection");
+                    }
+                    auto received = std::chrono::high_resolution_clock::now();
+                    latencies[c].push_back(std::chrono::duration<double, std::micro>(received - sent).count());
+
+                    // The reply must hold exactly one answer per query
+                    size_t pos = 0;
+                    for (int q = 0; q < batchSize && pos <= response.size(); q++) {
+                        pos++; // distance
+                        if ((flags & QUERY_WANT_PATH) && pos < response.size()) {
+                            pos += 1 + (size_t)(uint32_t)response[pos];
+                        } else if (flags & QUERY_WANT_PATH) {
+                            pos++;
+                        }
+                    }
+                    if (pos != response.size()) throw std::runtime_error("malformed response");
+                }
+            } catch (const std::exception& e) {
+                errors[c] = e.what();
             }
+            if (fd >= 0) ::close(fd);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    for (const auto& error : errors) {
+        if (!error.empty()) {
+            std::cerr << "Client error: " << error << "\n";
+            return 1;
         }
     }
-    
-    return dist;
+
+    std::vector<double> all;
+    for (const auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all.empty() ? 0 : all[std::min(all.size() - 1, (size_t)(p * all.size()))]; };
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "Clients\tBatch\tBatches\tp50 (us)\tp99 (us)\tQueries/s\n";
+    std::cout << clients << "\t" << batchSize << "\t" << all.size() << "\t" << percentile(0.5) << "\t\t"
+              << percentile(0.99) << "\t\t" << all.size() * batchSize / seconds << "\n";
+    return 0;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "server") return runServer(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "client") return runClient(argc, argv);
+
+    // Matrix output: off, text in output.txt, binary matrix_<V>_<test>.bin files
+    // (read back and checked), or auto: text up to textMatrixLimit vertices and
+    // binary above that
+    std::string matrixMode = argc > 1 ? argv[1] : "auto";
+    int textMatrixLimit = 50;
+    bool validMode = matrixMode == "off" || matrixMode == "text" || matrixMode == "binary" || matrixMode == "auto";
+    if (!validMode || argc > 3 ||
+        (argc > 2 && !parseArgument(argv[2], 0, std::numeric_limits<int>::max(), textMatrixLimit))) {
+        std::cerr << "Usage: " << argv[0] << " [off|text|binary|auto [text matrix limit]]\n"
+                  << "       " << argv[0] << " server ...\n"
+                  << "       " << argv[0] << " client ...\n";
+        return 1;
+    }
+
     std::ofstream outFile("output.txt");
     if (!outFile) {
         std::cerr << "Failed to open output.txt\n";
@@ -103,55 +2515,88 @@ int main() {
     std::vector<int> verticesCounts = {10, 20, 50, 100};
     std::vector<int> minConnectionsCounts = {3, 4, 10, 20};
     const int NUM_TESTS = 5;
-    
+    const unsigned SEED = 12345;
+
+    BufferedWriter writer(outFile);
+
     // Store timing results
     std::vector<std::pair<int, double>> timingResults;
-    
+
     for (size_t i = 0; i < verticesCounts.size(); i++) {
         int vertices = verticesCounts[i];
         int minConnections = minConnectionsCounts[i];
-        
-        outFile << "\nTesting graph with " << vertices << " vertices and minimum " 
+
+        outFile << "\nTesting graph with " << vertices << " vertices and minimum "
                 << minConnections << " connections per vertex\n\n";
-        
+
         double avgTime = 0;
-        
+
         for (int test = 0; test < NUM_TESTS; test++) {
             outFile << "Test " << (test + 1) << ":\n";
-            
+
             // Generate graph
-            auto graph = generateConnectedWeightedGraph(vertices, minConnections);
-            
+            auto graph = generateConnectedWeightedGraph(vertices, minConnections, SEED + i * NUM_TESTS + test);
+
             // Print adjacency matrix
-            printAdjacencyMatrix(outFile, graph);
-            
+            bool writeMatrix = matrixMode != "off";
+            bool binary = matrixMode == "binary" || (matrixMode == "auto" && vertices > textMatrixLimit);
+            if (writeMatrix && !binary) {
+                printAdjacencyMatrix(writer, graph);
+            } else if (writeMatrix) {
+                std::string matrixPath = "matrix_" + std::to_string(vertices) + "_" + std::to_string(test + 1) + ".bin";
+                {
+                    std::ofstream matrixFile(matrixPath, std::ios::binary);
+                    writeAdjacencyMatrixBinary(matrixFile, graph);
+                }
+                std::ifstream check(matrixPath, std::ios::binary);
+                outFile << "Adjacency Matrix: " << vertices << "x" << vertices << " written in binary form to "
+                        << matrixPath << (verifyAdjacencyMatrixBinary(check, graph) ? " (verified)" : " (MISMATCH)")
+                        << "\n\n";
+            }
+
             // Measure time for Dijkstra's algorithm from all vertices
             auto start = std::chrono::high_resolution_clock::now();
-            
+
             for (int source = 0; source < vertices; source++) {
                 dijkstra(graph, source);
             }
-            
+
             auto end = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
             avgTime += duration;
-            
+
             outFile << "Time taken: " << duration << " ms\n\n";
         }
-        
+
         avgTime /= NUM_TESTS;
         timingResults.push_back({vertices, avgTime});
-        
+
         outFile << "Average time for " << vertices << " vertices: " << avgTime << " ms\n";
     }
-    
+
     // Print final timing results for plotting
     outFile << "\nFinal timing results (for plotting):\n";
     outFile << "Vertices\tTime (ms)\n";
     for (const auto& result : timingResults) {
         outFile << result.first << "\t\t" << result.second << "\n";
     }
-    
+
+    benchmarkPointToPoint(outFile, verticesCounts, minConnectionsCounts, SEED);
+
+    benchmarkGenerator(outFile, SEED);
+
+    benchmarkApsp(outFile, SEED);
+
+    benchmarkContractionHierarchy(outFile, SEED);
+
+    benchmarkDeltaStepping(outFile, SEED);
+
+    benchmarkDynamicSSSP(outFile, SEED);
+
+    benchmarkCSRLayout(outFile, SEED);
+
+    benchmarkApspStore(outFile, SEED);
+
     outFile.close();
     return 0;
 }
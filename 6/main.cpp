@@ -5,6 +5,29 @@
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <string>
+#include <sstream>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <thread>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <string_view>
+#include <map>
+#include <cstdio>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 // Binary Search Tree Node
 template<typename T>
@@ -22,224 +45,2430 @@ struct AVLNode {
     AVLNode* left;
     AVLNode* right;
     int height;
-    AVLNode(T value) : data(value), left(nullptr), right(nullptr), height(1) {}
+    int size; // nodes in this subtree; fits in the padding after height
+    AVLNode(T value) : data(value), left(nullptr), right(nullptr), height(1), size(1) {}
 };
 
-// Binary Search Tree class
+// Node allocation through plain new/delete, one heap block per node
+template<typename Node>
+class HeapNodes {
+public:
+    static const bool BULK_RELEASE = false;
+
+    template<typename... Args>
+    Node* create(Args&&... args) {
+        return new Node(std::forward<Args>(args)...);
+    }
+
+    void destroy(Node* node) {
+        delete node;
+    }
+
+    void release() {}
+};
+
+// Per-tree node arena. Nodes are carved out of slabs of SLAB_NODES slots and removed
+// nodes go to a free list for reuse. release() frees every slab at once, in O(slabs),
+// without visiting the nodes.
+template<typename Node>
+class NodeArena {
+private:
+    static const size_t SLAB_NODES = 4096;
+
+    union Slot {
+        Slot* next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    std::vector<Slot*> slabs;
+    size_t slabUsed; // slots handed out from the newest slab
+    Slot* freeList;
+
+public:
+    static const bool BULK_RELEASE = true;
+
+    NodeArena() : slabUsed(SLAB_NODES), freeList(nullptr) {}
+
+    ~NodeArena() {
+        release();
+    }
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    template<typename... Args>
+    Node* create(Args&&... args) {
+        Slot* slot;
+        if (freeList) {
+            slot = freeList;
+            freeList = freeList->next;
+        } else {
+            if (slabUsed == SLAB_NODES) {
+                slabs.push_back(static_cast<Slot*>(::operator new(sizeof(Slot) * SLAB_NODES, std::align_val_t(alignof(Slot)))));
+                slabUsed = 0;
+            }
+            slot = &slabs.back()[slabUsed++];
+        }
+        return new (slot->storage) Node(std::forward<Args>(args)...);
+    }
+
+    void destroy(Node* node) {
+        node->~Node();
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        slot->next = freeList;
+        freeList = slot;
+    }
+
+    // Free all slabs; live nodes are dropped without running their destructors
+    void release() {
+        for (Slot* slab : slabs) ::operator delete(slab, std::align_val_t(alignof(Slot)));
+        slabs.clear();
+        slabUsed = SLAB_NODES;
+        freeList = nullptr;
+    }
+};
+
+// Destroy every node of a tree without recursion or extra memory: rotate left
+// children up until the root has none, then free the root and continue right
+template<typename Node, typename Alloc>
+void destroyTree(Node* root, Alloc& nodes) {
+    while (root) {
+        if (root->left) {
+            Node* left = root->left;
+            root->left = left->right;
+            left->right = root;
+            root = left;
+        } else {
+            Node* right = root->right;
+            nodes.destroy(root);
+            root = right;
+        }
+    }
+}
+
+// Look up many keys in a binary tree at once. Up to SEARCH_GROUP lookups are in
+// flight; each pass moves every one of them down one node and prefetches the node
+// it will read next, so the cache misses of different lookups overlap instead of
+// queuing. A finished lookup hands its slot to the next key straight away (AMAC,
+// asynchronous memory access chaining), so slots do not idle on short paths.
+template<typename Node, typename T>
+void searchInterleaved(const Node* root, const std::vector<T>& keys, std::vector<bool>& results) {
+    const size_t SEARCH_GROUP = 16;
+    const Node* nodes[SEARCH_GROUP];
+    size_t index[SEARCH_GROUP];
+    size_t next = 0, active = 0;
+
+    results.assign(keys.size(), false);
+    for (; active < SEARCH_GROUP && next < keys.size(); active++, next++) {
+        nodes[active] = root;
+        index[active] = next;
+    }
+
+    while (active > 0) {
+        for (size_t slot = 0; slot < active;) {
+            const Node* node = nodes[slot];
+            const T& key = keys[index[slot]];
+            if (node && node->data != key) {
+                node = key < node->data ? node->left : node->right;
+                __builtin_prefetch(node);
+                nodes[slot++] = node;
+                continue;
+            }
+
+            results[index[slot]] = node != nullptr;
+            if (next < keys.size()) {
+                nodes[slot] = root;
+                index[slot++] = next++;
+            } else {
+                active--;
+                nodes[slot] = nodes[active];
+                index[slot] = index[active];
+            }
+        }
+    }
+}
+
+// Sort large vectors with one chunk per hardware thread followed by rounds of
+// pairwise merges; small inputs or single-core machines use std::sort
 template<typename T>
+void parallelSort(std::vector<T>& values) {
+    const size_t PARALLEL_SORT_MIN = 1 << 16;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    if (values.size() < PARALLEL_SORT_MIN || threads < 2) {
+        std::sort(values.begin(), values.end());
+        return;
+    }
+
+    std::vector<size_t> bounds;
+    for (size_t t = 0; t <= threads; t++) bounds.push_back(values.size() * t / threads);
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            std::sort(values.begin() + bounds[t], values.begin() + bounds[t + 1]);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    while (bounds.size() > 2) {
+        std::vector<size_t> next;
+        workers.clear();
+        for (size_t c = 0; c + 1 < bounds.size(); c += 2) {
+            next.push_back(bounds[c]);
+            if (c + 2 < bounds.size()) {
+                workers.emplace_back([&, c]() {
+                    std::inplace_merge(values.begin() + bounds[c], values.begin() + bounds[c + 1],
+                                       values.begin() + bounds[c + 2]);
+                });
+            }
+        }
+        next.push_back(bounds.back());
+        for (auto& worker : workers) worker.join();
+        bounds = next;
+    }
+}
+
+// Binary Search Tree class
+// All operations are iterative, so degenerate (sorted) inputs cost time but no stack
+template<typename T, template<typename> class NodeAlloc = NodeArena>
 class BST {
 private:
     BSTNode<T>* root;
+    NodeAlloc<BSTNode<T>> nodes;
+
+public:
+    BST() : root(nullptr) {}
+
+    ~BST() {
+        clear();
+    }
+
+    BST(const BST&) = delete;
+    BST& operator=(const BST&) = delete;
+
+    // Remove all elements; with the arena and trivially destructible T this is O(slabs)
+    void clear() {
+        if (!NodeAlloc<BSTNode<T>>::BULK_RELEASE || !std::is_trivially_destructible<T>::value)
+            destroyTree(root, nodes);
+        nodes.release();
+        root = nullptr;
+    }
+
+    void insert(T value) {
+        BSTNode<T>** link = &root;
+        while (*link) {
+            if (value < (*link)->data) link = &(*link)->left;
+            else if (value > (*link)->data) link = &(*link)->right;
+            else return;
+        }
+        *link = nodes.create(value);
+    }
+
+    bool search(T value) {
+        BSTNode<T>* node = root;
+        while (node && node->data != value) {
+            node = value < node->data ? node->left : node->right;
+        }
+        return node != nullptr;
+    }
+
+    // Look up every key; results[i] tells whether keys[i] is present
+    void searchBatch(const std::vector<T>& keys, std::vector<bool>& results) const {
+        searchInterleaved(root, keys, results);
+    }
+
+    void remove(T value) {
+        BSTNode<T>** link = &root;
+        while (*link && (*link)->data != value) {
+            link = value < (*link)->data ? &(*link)->left : &(*link)->right;
+        }
+        BSTNode<T>* node = *link;
+        if (!node) return;
+
+        if (node->left && node->right) {
+            // Replace with the in-order successor and unlink that instead
+            BSTNode<T>** succLink = &node->right;
+            while ((*succLink)->left) succLink = &(*succLink)->left;
+            BSTNode<T>* succ = *succLink;
+            node->data = succ->data;
+            *succLink = succ->right;
+            nodes.destroy(succ);
+        } else {
+            *link = node->left ? node->left : node->right;
+            nodes.destroy(node);
+        }
+    }
+};
+
+// Linear membership scan. int keys are compared eight at a time with AVX2.
+template<typename T>
+bool linearScan(const T* keys, size_t count, const T& value) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    if constexpr (std::is_same<T, int>::value) {
+        __m256i needle = _mm256_set1_epi32(value);
+        for (; i + 8 <= count; i += 8) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(block, needle))) return true;
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        if (keys[i] == value) return true;
+    }
+    return false;
+}
+
+// Number of keys in sorted keys[0 .. count) below value, or not above it when
+// INCLUSIVE. Every key is compared, eight ints at a time with AVX2, so the only
+// branch is the loop bound.
+template<bool INCLUSIVE, typename T>
+int countBelow(const T* keys, int count, const T& value) {
+    int i = 0, below = 0;
+#if defined(__AVX2__)
+    if constexpr (std::is_same<T, int>::value) {
+        __m256i needle = _mm256_set1_epi32(value);
+        for (; i + 8 <= count; i += 8) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            __m256i above = INCLUSIVE ? _mm256_cmpgt_epi32(block, needle) : _mm256_cmpgt_epi32(needle, block);
+            int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(above)));
+            below += INCLUSIVE ? 8 - bits : bits;
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        below += INCLUSIVE ? !(value < keys[i]) : keys[i] < value;
+    }
+    return below;
+}
+
+// Immutable sorted set in Eytzinger (BFS) order: slot k holds the node whose
+// children are slots 2k and 2k+1, so the top levels share cache lines and a search
+// can prefetch the slots four levels below before it needs them. Sets of up to
+// SCAN_LIMIT keys stay in plain sorted order and are scanned linearly.
+template<typename T>
+class EytzingerArray {
+private:
+    static const size_t CACHE_LINE = 64;
+    static const size_t SCAN_LIMIT = 64;
+    // Slots 16k ... 16k+15 are the descendants of k four levels down
+    static const size_t PREFETCH_LEVELS = 4;
+
+    std::vector<T> storage;
+    const T* keys = nullptr; // keys[1 .. count], or keys[0 .. count) when scanned
+    size_t count = 0;
+
+    // In-order walk of the implicit tree places the sorted keys
+    void place(const std::vector<T>& sorted, size_t& next, T* slots, size_t k) {
+        if (k > count) return;
+        place(sorted, next, slots, 2 * k);
+        slots[k] = sorted[next++];
+        place(sorted, next, slots, 2 * k + 1);
+    }
+
+public:
+    // sorted must be in ascending order without duplicates
+    explicit EytzingerArray(const std::vector<T>& sorted) : count(sorted.size()) {
+        if (count <= SCAN_LIMIT) {
+            storage = sorted;
+            keys = storage.data();
+            return;
+        }
+
+        // Align slot 0 to a cache line so every group of descendants shares one line
+        size_t pad = CACHE_LINE / sizeof(T) + 1;
+        storage.resize(count + 1 + pad);
+        T* slots = storage.data();
+        while (reinterpret_cast<uintptr_t>(slots) % CACHE_LINE && slots < storage.data() + pad) slots++;
+        size_t next = 0;
+        place(sorted, next, slots, 1);
+        keys = slots;
+    }
+
+    EytzingerArray(const EytzingerArray&) = delete;
+    EytzingerArray& operator=(const EytzingerArray&) = delete;
+    EytzingerArray(EytzingerArray&&) = default;
+
+    size_t size() const {
+        return count;
+    }
+
+    bool search(const T& value) const {
+        if (count <= SCAN_LIMIT) return linearScan(keys, count, value);
+
+        size_t k = 1;
+        while (k <= count) {
+            // Address arithmetic only: the slots may lie past the end, and a
+            // prefetch of an unmapped address is dropped without a fault
+            __builtin_prefetch(reinterpret_cast<const void*>(
+                reinterpret_cast<uintptr_t>(keys) + (k << PREFETCH_LEVELS) * sizeof(T)));
+            k = 2 * k + (keys[k] < value);
+        }
+        // Strip the trailing right turns taken after the lower bound
+        k >>= __builtin_ffsll(~k);
+        return k != 0 && !(value < keys[k]);
+    }
+};
+
+// Rotations and rebalancing shared by AVLTree and AVLMap, for any node type with
+// left, right and height. Bookkeeping::update recomputes whatever else a node
+// keeps about its subtree from its children; it runs after every height update and
+// on the ancestors above the point where the heights stop changing.
+template<typename Node, typename Bookkeeping>
+struct AVLRebalance {
+    static int height(const Node* node) {
+        return node ? node->height : 0;
+    }
+
+    static void update(Node* node) {
+        node->height = std::max(height(node->left), height(node->right)) + 1;
+        Bookkeeping::update(node);
+    }
+
+    static int getBalance(const Node* node) {
+        return height(node->left) - height(node->right);
+    }
+
+    static Node* rightRotate(Node* y) {
+        Node* x = y->left;
+        y->left = x->right;
+        x->right = y;
+        update(y);
+        update(x);
+        return x;
+    }
+
+    static Node* leftRotate(Node* x) {
+        Node* y = x->right;
+        x->right = y->left;
+        y->left = x;
+        update(x);
+        update(y);
+        return y;
+    }
+
+    // Update node and restore the AVL property at it, return the new subtree root
+    static Node* rebalance(Node* node) {
+        update(node);
+        int balance = getBalance(node);
+
+        if (balance > 1) {
+            // Left Right
+            if (getBalance(node->left) < 0)
+                node->left = leftRotate(node->left);
+            // Left Left
+            return rightRotate(node);
+        }
+
+        if (balance < -1) {
+            // Right Left
+            if (getBalance(node->right) > 0)
+                node->right = rightRotate(node->right);
+            // Right Right
+            return leftRotate(node);
+        }
+
+        return node;
+    }
+
+    // Walk a recorded path of child links bottom-up. Once a subtree keeps its old
+    // height no rotation can happen above it, and only the bookkeeping still needs
+    // fixing.
+    static void rebalancePath(Node** path[], int depth) {
+        while (depth-- > 0) {
+            Node** link = path[depth];
+            int before = (*link)->height;
+            *link = rebalance(*link);
+            if ((*link)->height == before) break;
+        }
+        while (depth-- > 0) Bookkeeping::update(*path[depth]);
+    }
+};
+
+// Nodes that keep nothing beyond their height
+struct NoBookkeeping {
+    template<typename Node>
+    static void update(Node*) {}
+};
+
+// Nodes that also keep the size of their subtree, for order statistics
+struct SizeBookkeeping {
+    template<typename Node>
+    static void update(Node* node) {
+        node->size = (node->left ? node->left->size : 0) + (node->right ? node->right->size : 0) + 1;
+    }
+};
+
+// AVL Tree class
+// Operations descend iteratively and record the path of child links in a fixed
+// array, then rebalance on the way back up. An AVL tree of height 64 would need
+// more than 2^44 nodes, so the array cannot overflow.
+template<typename T, template<typename> class NodeAlloc = NodeArena>
+class AVLTree {
+private:
+    static const int MAX_HEIGHT = 64;
+    // Cost of one node of a bulkInsert merge in steps of an insert descent
+    static constexpr size_t BULK_MERGE_COST = 4;
+
+    using Balance = AVLRebalance<AVLNode<T>, SizeBookkeeping>;
+
+    AVLNode<T>* root;
+    NodeAlloc<AVLNode<T>> nodes;
+
+    static int subtreeSize(const AVLNode<T>* node) {
+        return node ? node->size : 0;
+    }
+
+    // Link list[lo, hi) into a perfectly balanced subtree by midpoint splitting
+    AVLNode<T>* linkBalanced(const std::vector<AVLNode<T>*>& list, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        AVLNode<T>* node = list[mid];
+        node->left = linkBalanced(list, lo, mid);
+        node->right = linkBalanced(list, mid + 1, hi);
+        Balance::update(node);
+        return node;
+    }
+
+    // Copy [first, last) into a sorted vector without duplicates
+    template<typename It>
+    static std::vector<T> sortedUnique(It first, It last) {
+        std::vector<T> values(first, last);
+        if (!std::is_sorted(values.begin(), values.end())) parallelSort(values);
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        return values;
+    }
+
+public:
+    AVLTree() : root(nullptr) {}
+
+    ~AVLTree() {
+        clear();
+    }
+
+    AVLTree(const AVLTree&) = delete;
+    AVLTree& operator=(const AVLTree&) = delete;
+
+    // Remove all elements; with the arena and trivially destructible T this is O(slabs)
+    void clear() {
+        if (!NodeAlloc<AVLNode<T>>::BULK_RELEASE || !std::is_trivially_destructible<T>::value)
+            destroyTree(root, nodes);
+        nodes.release();
+        root = nullptr;
+    }
+
+    void insert(T value) {
+        AVLNode<T>** path[MAX_HEIGHT];
+        int depth = 0;
+        AVLNode<T>** link = &root;
+        while (*link) {
+            path[depth++] = link;
+            if (value < (*link)->data) link = &(*link)->left;
+            else if (value > (*link)->data) link = &(*link)->right;
+            else return;
+        }
+        *link = nodes.create(value);
+        Balance::rebalancePath(path, depth);
+    }
+
+    bool search(T value) {
+        AVLNode<T>* node = root;
+        while (node && node->data != value) {
+            node = value < node->data ? node->left : node->right;
+        }
+        return node != nullptr;
+    }
+
+    // Look up every key; results[i] tells whether keys[i] is present
+    void searchBatch(const std::vector<T>& keys, std::vector<bool>& results) const {
+        searchInterleaved(root, keys, results);
+    }
+
+    void remove(T value) {
+        AVLNode<T>** path[MAX_HEIGHT];
+        int depth = 0;
+        AVLNode<T>** link = &root;
+        while (*link && (*link)->data != value) {
+            path[depth++] = link;
+            link = value < (*link)->data ? &(*link)->left : &(*link)->right;
+        }
+        AVLNode<T>* node = *link;
+        if (!node) return;
+
+        if (node->left && node->right) {
+            // Replace with the in-order successor and unlink that instead
+            path[depth++] = link;
+            AVLNode<T>** succLink = &node->right;
+            while ((*succLink)->left) {
+                path[depth++] = succLink;
+                succLink = &(*succLink)->left;
+            }
+            AVLNode<T>* succ = *succLink;
+            node->data = succ->data;
+            *succLink = succ->right;
+            nodes.destroy(succ);
+        } else {
+            *link = node->left ? node->left : node->right;
+            nodes.destroy(node);
+        }
+        Balance::rebalancePath(path, depth);
+    }
+
+    // Replace the contents with the values of [first, last). Sorted input is linked
+    // into a perfectly balanced tree in O(n) with no rotations; unsorted input is
+    // sorted first (in parallel for large n).
+    template<typename It>
+    void buildFrom(It first, It last) {
+        std::vector<T> values = sortedUnique(first, last);
+        clear();
+
+        std::vector<AVLNode<T>*> list;
+        list.reserve(values.size());
+        for (const T& value : values) list.push_back(nodes.create(value));
+        root = linkBalanced(list, 0, list.size());
+    }
+
+    // Add the values of [first, last). A batch that is large relative to the tree is
+    // merged into the tree's in-order node sequence and relinked in O(n + m); a small
+    // one goes through insert, which costs O(m log n) but touches far fewer nodes.
+    template<typename It>
+    void bulkInsert(It first, It last) {
+        std::vector<T> values = sortedUnique(first, last);
+        if (values.empty()) return;
+
+        // A merge visits all of the (at least 2^(height-1)) nodes, an insert descends
+        // height levels per value
+        size_t estimate = root ? (size_t(1) << (Balance::height(root) - 1)) : 0;
+        if (values.size() * Balance::height(root) < estimate * BULK_MERGE_COST) {
+            for (const T& value : values) insert(value);
+            return;
+        }
+
+        std::vector<AVLNode<T>*> merged;
+        merged.reserve(estimate + values.size());
+        std::vector<AVLNode<T>*> stack;
+        AVLNode<T>* node = root;
+        auto next = values.begin();
+        while (node || !stack.empty()) {
+            for (; node; node = node->left) stack.push_back(node);
+            node = stack.back();
+            stack.pop_back();
+            for (; next != values.end() && *next < node->data; ++next) {
+                merged.push_back(nodes.create(*next));
+            }
+            if (next != values.end() && !(node->data < *next)) ++next; // already present
+            merged.push_back(node);
+            node = node->right;
+        }
+        for (; next != values.end(); ++next) merged.push_back(nodes.create(*next));
+        root = linkBalanced(merged, 0, merged.size());
+    }
+
+    // Immutable copy of the keys laid out for fast lookups
+    EytzingerArray<T> freeze() const {
+        std::vector<T> sorted;
+        std::vector<const AVLNode<T>*> stack;
+        const AVLNode<T>* node = root;
+        while (node || !stack.empty()) {
+            for (; node; node = node->left) stack.push_back(node);
+            node = stack.back();
+            stack.pop_back();
+            sorted.push_back(node->data);
+            node = node->right;
+        }
+        return EytzingerArray<T>(sorted);
+    }
+
+    // Height of the tree (0 when empty)
+    int getMaxDepth() {
+        return Balance::height(root);
+    }
+
+    // In-order iterator over the keys. The pending ancestors sit in a fixed array,
+    // so creating and advancing an iterator never allocates; it must not outlive a
+    // modification of the tree.
+    class Iterator {
+    private:
+        const AVLNode<T>* stack[MAX_HEIGHT];
+        int depth = 0;
+
+        void pushLeftPath(const AVLNode<T>* node) {
+            for (; node; node = node->left) stack[depth++] = node;
+        }
+
+        friend class AVLTree;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const T& operator*() const {
+            return stack[depth - 1]->data;
+        }
+
+        const T* operator->() const {
+            return &stack[depth - 1]->data;
+        }
+
+        Iterator& operator++() {
+            const AVLNode<T>* node = stack[--depth];
+            pushLeftPath(node->right);
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const Iterator& other) const {
+            if (depth == 0 || other.depth == 0) return depth == other.depth;
+            return stack[depth - 1] == other.stack[other.depth - 1];
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    Iterator begin() const {
+        Iterator it;
+        it.pushLeftPath(root);
+        return it;
+    }
+
+    Iterator end() const {
+        return Iterator();
+    }
+
+    // First key not below value
+    Iterator lowerBound(const T& value) const {
+        Iterator it;
+        for (const AVLNode<T>* node = root; node;) {
+            if (node->data < value) {
+                node = node->right;
+            } else {
+                it.stack[it.depth++] = node;
+                node = node->left;
+            }
+        }
+        return it;
+    }
+
+    // First key above value
+    Iterator upperBound(const T& value) const {
+        Iterator it;
+        for (const AVLNode<T>* node = root; node;) {
+            if (value < node->data) {
+                it.stack[it.depth++] = node;
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        return it;
+    }
+
+    size_t size() const {
+        return subtreeSize(root);
+    }
+
+    // Number of keys below value, or not above it when inclusive
+    size_t rank(const T& value, bool inclusive = false) const {
+        size_t below = 0;
+        for (const AVLNode<T>* node = root; node;) {
+            if (node->data < value || (inclusive && !(value < node->data))) {
+                below += subtreeSize(node->left) + 1;
+                node = node->right;
+            } else {
+                node = node->left;
+            }
+        }
+        return below;
+    }
+
+    // Key with exactly k smaller keys (0-based)
+    const T& select(size_t k) const {
+        if (k >= size()) throw std::out_of_range("AVLTree::select: rank out of range");
+        const AVLNode<T>* node = root;
+        while (true) {
+            size_t leftSize = subtreeSize(node->left);
+            if (k < leftSize) {
+                node = node->left;
+            } else if (k == leftSize) {
+                return node->data;
+            } else {
+                k -= leftSize + 1;
+                node = node->right;
+            }
+        }
+    }
+
+    // Number of keys in [low, high]
+    size_t countRange(const T& low, const T& high) const {
+        if (high < low) return 0;
+        return rank(high, true) - rank(low);
+    }
+};
+
+// Node of AVLMap: the key/value pair is built in place from the arguments
+template<typename Key, typename Value>
+struct AVLMapNode {
+    std::pair<const Key, Value> entry;
+    AVLMapNode* left;
+    AVLMapNode* right;
+    int height;
+
+    template<typename... Args>
+    AVLMapNode(Args&&... args) : entry(std::forward<Args>(args)...), left(nullptr), right(nullptr), height(1) {}
+};
+
+// Ordered map on an AVL tree. Keys are taken by reference and compared with
+// Compare; with a transparent comparator such as std::less<> lookups accept any
+// type comparable with Key (a string_view against string keys) and build no Key.
+// Entries are constructed in place and never copied or moved afterwards, so Value
+// may be move-only. Nodes come from Alloc rebound to the node type.
+template<typename Key, typename Value, typename Compare = std::less<Key>,
+         typename Alloc = std::allocator<std::pair<const Key, Value>>>
+class AVLMap {
+public:
+    using value_type = std::pair<const Key, Value>;
+
+private:
+    using Node = AVLMapNode<Key, Value>;
+    using NodeAllocator = typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+    using NodeTraits = std::allocator_traits<NodeAllocator>;
+    using Balance = AVLRebalance<Node, NoBookkeeping>;
+
+    static const int MAX_HEIGHT = 64;
+
+    Node* root;
+    size_t count;
+    Compare compare;
+    NodeAllocator nodes;
+
+    template<typename... Args>
+    Node* createNode(Args&&... args) {
+        Node* node = NodeTraits::allocate(nodes, 1);
+        try {
+            NodeTraits::construct(nodes, node, std::forward<Args>(args)...);
+        } catch (...) {
+            NodeTraits::deallocate(nodes, node, 1);
+            throw;
+        }
+        return node;
+    }
+
+    void destroyNode(Node* node) {
+        NodeTraits::destroy(nodes, node);
+        NodeTraits::deallocate(nodes, node, 1);
+    }
+
+    // Adapter for destroyTree
+    struct NodeReleaser {
+        AVLMap* map;
+
+        void destroy(Node* node) {
+            map->destroyNode(node);
+        }
+    };
+
+    // Node holding key, or nullptr. Descends like a lower bound and checks for
+    // equality once at the end: one comparison per level instead of two, which
+    // matters when comparing is a memcmp.
+    template<typename K>
+    Node* findNode(const K& key) const {
+        Node* candidate = nullptr;
+        for (Node* node = root; node;) {
+            if (compare(node->entry.first, key)) {
+                node = node->right;
+            } else {
+                candidate = node;
+                node = node->left;
+            }
+        }
+        return candidate && !compare(key, candidate->entry.first) ? candidate : nullptr;
+    }
+
+    // Descend to key, recording the links passed in path. Returns the node holding
+    // key, or nullptr with *link the empty link where it belongs.
+    template<typename K>
+    Node* descend(const K& key, Node** path[], int& depth, Node**& link) {
+        Node* candidate = nullptr;
+        depth = 0;
+        link = &root;
+        while (*link) {
+            path[depth++] = link;
+            Node* node = *link;
+            if (compare(node->entry.first, key)) {
+                link = &node->right;
+            } else {
+                candidate = node;
+                link = &node->left;
+            }
+        }
+        return candidate && !compare(key, candidate->entry.first) ? candidate : nullptr;
+    }
+
+    template<typename K, typename... Args>
+    std::pair<value_type*, bool> tryEmplace(K&& key, Args&&... args) {
+        Node** path[MAX_HEIGHT];
+        int depth;
+        Node** link;
+        if (Node* found = descend(key, path, depth, link)) return {&found->entry, false};
+
+        *link = createNode(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                           std::forward_as_tuple(std::forward<Args>(args)...));
+        value_type* entry = &(*link)->entry;
+        count++;
+        Balance::rebalancePath(path, depth);
+        return {entry, true};
+    }
+
+    template<typename K>
+    bool eraseKey(const K& key) {
+        Node** path[MAX_HEIGHT];
+        int depth = 0;
+        Node** link = &root;
+        while (*link) {
+            Node* node = *link;
+            if (compare(key, node->entry.first)) {
+                path[depth++] = link;
+                link = &node->left;
+            } else if (compare(node->entry.first, key)) {
+                path[depth++] = link;
+                link = &node->right;
+            } else {
+                break;
+            }
+        }
+        Node* node = *link;
+        if (!node) return false;
+
+        if (node->left && node->right) {
+            // Entries cannot be reassigned (the key is const, the value may be
+            // move-only), so the in-order successor node takes this node's place
+            path[depth++] = link;
+            int rightDepth = depth;
+            Node** succLink = &node->right;
+            while ((*succLink)->left) {
+                path[depth++] = succLink;
+                succLink = &(*succLink)->left;
+            }
+            Node* succ = *succLink;
+            *succLink = succ->right;
+            succ->left = node->left;
+            succ->right = node->right;
+            succ->height = node->height;
+            *link = succ;
+            if (depth > rightDepth) path[rightDepth] = &succ->right;
+        } else {
+            *link = node->left ? node->left : node->right;
+        }
+        destroyNode(node);
+        count--;
+        Balance::rebalancePath(path, depth);
+        return true;
+    }
+
+public:
+    explicit AVLMap(const Compare& comparator = Compare(), const Alloc& alloc = Alloc())
+        : root(nullptr), count(0), compare(comparator), nodes(alloc) {}
+
+    ~AVLMap() {
+        clear();
+    }
+
+    AVLMap(const AVLMap&) = delete;
+    AVLMap& operator=(const AVLMap&) = delete;
+
+    void clear() {
+        NodeReleaser releaser{this};
+        destroyTree(root, releaser);
+        root = nullptr;
+        count = 0;
+    }
+
+    // Insert key -> Value(args...) unless key is present; nothing is constructed,
+    // and key is not moved from, when it is. With a transparent comparator key may
+    // be any type Key can be built from, e.g. a string_view.
+    template<typename... Args>
+    std::pair<value_type*, bool> try_emplace(const Key& key, Args&&... args) {
+        return tryEmplace(key, std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    std::pair<value_type*, bool> try_emplace(Key&& key, Args&&... args) {
+        return tryEmplace(std::move(key), std::forward<Args>(args)...);
+    }
+
+    template<typename K, typename... Args, typename C = Compare, typename = typename C::is_transparent>
+    std::pair<value_type*, bool> try_emplace(K&& key, Args&&... args) {
+        return tryEmplace(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    // Build an entry from args as the pair constructor would, then insert it unless
+    // its key is present. As with std::map the node is built before the lookup, so
+    // try_emplace is cheaper when the key may already be there.
+    template<typename... Args>
+    std::pair<value_type*, bool> emplace(Args&&... args) {
+        Node* node = createNode(std::forward<Args>(args)...);
+        Node** path[MAX_HEIGHT];
+        int depth;
+        Node** link;
+        if (Node* found = descend(node->entry.first, path, depth, link)) {
+            destroyNode(node);
+            return {&found->entry, false};
+        }
+        *link = node;
+        count++;
+        Balance::rebalancePath(path, depth);
+        return {&node->entry, true};
+    }
+
+    Value& operator[](const Key& key) {
+        return try_emplace(key).first->second;
+    }
+
+    Value& operator[](Key&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    // Entry for key, or nullptr
+    value_type* find(const Key& key) {
+        Node* node = findNode(key);
+        return node ? &node->entry : nullptr;
+    }
+
+    const value_type* find(const Key& key) const {
+        Node* node = findNode(key);
+        return node ? &node->entry : nullptr;
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    value_type* find(const K& key) {
+        Node* node = findNode(key);
+        return node ? &node->entry : nullptr;
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    const value_type* find(const K& key) const {
+        Node* node = findNode(key);
+        return node ? &node->entry : nullptr;
+    }
+
+    bool contains(const Key& key) const {
+        return findNode(key) != nullptr;
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K& key) const {
+        return findNode(key) != nullptr;
+    }
+
+    Value& at(const Key& key) {
+        Node* node = findNode(key);
+        if (!node) throw std::out_of_range("AVLMap::at: key not found");
+        return node->entry.second;
+    }
+
+    const Value& at(const Key& key) const {
+        Node* node = findNode(key);
+        if (!node) throw std::out_of_range("AVLMap::at: key not found");
+        return node->entry.second;
+    }
+
+    // Remove key; returns whether it was present
+    bool erase(const Key& key) {
+        return eraseKey(key);
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool erase(const K& key) {
+        return eraseKey(key);
+    }
+
+    // Visit the entries in key order
+    template<typename Visit>
+    void forEach(Visit visit) const {
+        const Node* stack[MAX_HEIGHT];
+        int depth = 0;
+        const Node* node = root;
+        while (node || depth > 0) {
+            for (; node; node = node->left) stack[depth++] = node;
+            node = stack[--depth];
+            visit(node->entry);
+            node = node->right;
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // Height of the tree (0 when empty)
+    int getMaxDepth() const {
+        return Balance::height(root);
+    }
+};
+
+// B+-tree with nodes of NODE_BYTES (a multiple of the 64-byte cache line). Inner
+// nodes hold only separators and child pointers, keys live in the leaves, and
+// leaves are chained for range scans. keys[i] of an inner node is a lower bound of
+// children[i + 1] and above every key of children[i]. Searching inside a node
+// counts keys with countBelow instead of a binary search.
+template<typename T, size_t NODE_BYTES = 256, template<typename> class NodeAlloc = NodeArena>
+class BPlusTree {
+private:
+    static const int HEADER_BYTES = 2 * sizeof(void*);
+    static const int LEAF_KEYS = (NODE_BYTES - HEADER_BYTES) / sizeof(T);
+    static const int INNER_KEYS = (NODE_BYTES - HEADER_BYTES) / (sizeof(T) + sizeof(void*));
+    static const int MIN_LEAF_KEYS = LEAF_KEYS / 2;
+    static const int MIN_INNER_KEYS = INNER_KEYS / 2;
+    // Inner nodes have at least three children, so 32 levels is more than enough
+    static const int MAX_LEVELS = 32;
+
+    struct alignas(64) Leaf {
+        int count = 0;
+        Leaf* next = nullptr;
+        T keys[LEAF_KEYS];
+    };
+
+    struct alignas(64) Inner {
+        int count = 0; // keys; there are count + 1 children
+        T keys[INNER_KEYS];
+        void* children[INNER_KEYS + 1];
+    };
+
+    static_assert(INNER_KEYS >= 4, "NODE_BYTES too small for this key type");
+    static_assert(sizeof(Leaf) <= NODE_BYTES && sizeof(Inner) <= NODE_BYTES, "node exceeds NODE_BYTES");
+
+    void* root;
+    int levels; // 0 when empty, 1 when the root is a leaf
+    NodeAlloc<Leaf> leaves;
+    NodeAlloc<Inner> inners;
+
+    template<typename U>
+    static void insertAt(U* items, int count, int pos, const U& item) {
+        std::copy_backward(items + pos, items + count, items + count + 1);
+        items[pos] = item;
+    }
+
+    template<typename U>
+    static void eraseAt(U* items, int count, int pos) {
+        std::copy(items + pos + 1, items + count, items + pos);
+    }
+
+    // Descend to the leaf that may hold value, recording inner nodes and child slots
+    Leaf* descend(const T& value, Inner** path, int* slot) const {
+        void* node = root;
+        for (int level = 0; level + 1 < levels; level++) {
+            Inner* inner = static_cast<Inner*>(node);
+            int i = countBelow<true>(inner->keys, inner->count, value);
+            if (path) {
+                path[level] = inner;
+                slot[level] = i;
+            }
+            node = inner->children[i];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    // Refill an underfull leaf (child i of parent) from a sibling or merge it with
+    // one. Returns true when the parent lost a key.
+    bool fixLeaf(Leaf* leaf, Inner* parent, int i) {
+        Leaf* left = i > 0 ? static_cast<Leaf*>(parent->children[i - 1]) : nullptr;
+        Leaf* right = i < parent->count ? static_cast<Leaf*>(parent->children[i + 1]) : nullptr;
+
+        if (left && left->count > MIN_LEAF_KEYS) {
+            insertAt(leaf->keys, leaf->count++, 0, left->keys[--left->count]);
+            parent->keys[i - 1] = leaf->keys[0];
+            return false;
+        }
+        if (right && right->count > MIN_LEAF_KEYS) {
+            leaf->keys[leaf->count++] = right->keys[0];
+            eraseAt(right->keys, right->count--, 0);
+            parent->keys[i] = right->keys[0];
+            return false;
+        }
+
+        // Merge the right one of the pair into the left one
+        if (left) {
+            right = leaf;
+            leaf = left;
+            i--;
+        }
+        std::copy(right->keys, right->keys + right->count, leaf->keys + leaf->count);
+        leaf->count += right->count;
+        leaf->next = right->next;
+        leaves.destroy(right);
+        eraseAt(parent->keys, parent->count, i);
+        eraseAt(parent->children, parent->count + 1, i + 1);
+        parent->count--;
+        return true;
+    }
+
+    // Same for an underfull inner node; separators rotate through the parent
+    bool fixInner(Inner* node, Inner* parent, int i) {
+        Inner* left = i > 0 ? static_cast<Inner*>(parent->children[i - 1]) : nullptr;
+        Inner* right = i < parent->count ? static_cast<Inner*>(parent->children[i + 1]) : nullptr;
+
+        if (left && left->count > MIN_INNER_KEYS) {
+            insertAt(node->keys, node->count, 0, parent->keys[i - 1]);
+            insertAt(node->children, node->count + 1, 0, left->children[left->count]);
+            node->count++;
+            parent->keys[i - 1] = left->keys[--left->count];
+            return false;
+        }
+        if (right && right->count > MIN_INNER_KEYS) {
+            node->keys[node->count] = parent->keys[i];
+            node->children[++node->count] = right->children[0];
+            parent->keys[i] = right->keys[0];
+            eraseAt(right->keys, right->count, 0);
+            eraseAt(right->children, right->count + 1, 0);
+            right->count--;
+            return false;
+        }
+
+        if (left) {
+            right = node;
+            node = left;
+            i--;
+        }
+        node->keys[node->count] = parent->keys[i];
+        std::copy(right->keys, right->keys + right->count, node->keys + node->count + 1);
+        std::copy(right->children, right->children + right->count + 1, node->children + node->count + 1);
+        node->count += right->count + 1;
+        inners.destroy(right);
+        eraseAt(parent->keys, parent->count, i);
+        eraseAt(parent->children, parent->count + 1, i + 1);
+        parent->count--;
+        return true;
+    }
+
+    void destroyNodes(void* node, int level) {
+        if (level + 1 < levels) {
+            Inner* inner = static_cast<Inner*>(node);
+            for (int i = 0; i <= inner->count; i++) destroyNodes(inner->children[i], level + 1);
+            inners.destroy(inner);
+        } else {
+            leaves.destroy(static_cast<Leaf*>(node));
+        }
+    }
+
+public:
+    BPlusTree() : root(nullptr), levels(0) {}
+
+    ~BPlusTree() {
+        clear();
+    }
+
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    // Remove all elements; with the arena and trivially destructible T this is O(slabs)
+    void clear() {
+        if (root && (!NodeAlloc<Leaf>::BULK_RELEASE || !std::is_trivially_destructible<T>::value))
+            destroyNodes(root, 0);
+        leaves.release();
+        inners.release();
+        root = nullptr;
+        levels = 0;
+    }
+
+    void insert(T value) {
+        if (!root) {
+            Leaf* leaf = leaves.create();
+            leaf->keys[leaf->count++] = value;
+            root = leaf;
+            levels = 1;
+            return;
+        }
+
+        Inner* path[MAX_LEVELS];
+        int slot[MAX_LEVELS];
+        Leaf* leaf = descend(value, path, slot);
+        int pos = countBelow<false>(leaf->keys, leaf->count, value);
+        if (pos < leaf->count && !(value < leaf->keys[pos])) return;
+
+        if (leaf->count < LEAF_KEYS) {
+            insertAt(leaf->keys, leaf->count++, pos, value);
+            return;
+        }
+
+        // Split the full leaf in half and push the first key of the new one up
+        Leaf* sibling = leaves.create();
+        int half = LEAF_KEYS / 2;
+        std::copy(leaf->keys + half, leaf->keys + LEAF_KEYS, sibling->keys);
+        sibling->count = LEAF_KEYS - half;
+        leaf->count = half;
+        sibling->next = leaf->next;
+        leaf->next = sibling;
+        if (pos <= half) insertAt(leaf->keys, leaf->count++, pos, value);
+        else insertAt(sibling->keys, sibling->count++, pos - half, value);
+
+        T separator = sibling->keys[0];
+        void* child = sibling;
+        for (int level = levels - 2; level >= 0; level--) {
+            Inner* inner = path[level];
+            int i = slot[level];
+            if (inner->count < INNER_KEYS) {
+                insertAt(inner->keys, inner->count, i, separator);
+                insertAt(inner->children, inner->count + 1, i + 1, child);
+                inner->count++;
+                return;
+            }
+
+            // Split the full inner node; its middle key moves up
+            T keys[INNER_KEYS + 1];
+            void* children[INNER_KEYS + 2];
+            std::copy(inner->keys, inner->keys + INNER_KEYS, keys);
+            std::copy(inner->children, inner->children + INNER_KEYS + 1, children);
+            insertAt(keys, INNER_KEYS, i, separator);
+            insertAt(children, INNER_KEYS + 1, i + 1, child);
+
+            int mid = (INNER_KEYS + 1) / 2;
+            Inner* split = inners.create();
+            std::copy(keys, keys + mid, inner->keys);
+            std::copy(children, children + mid + 1, inner->children);
+            inner->count = mid;
+            std::copy(keys + mid + 1, keys + INNER_KEYS + 1, split->keys);
+            std::copy(children + mid + 1, children + INNER_KEYS + 2, split->children);
+            split->count = INNER_KEYS - mid;
+
+            separator = keys[mid];
+            child = split;
+        }
+
+        Inner* top = inners.create();
+        top->keys[0] = separator;
+        top->children[0] = root;
+        top->children[1] = child;
+        top->count = 1;
+        root = top;
+        levels++;
+    }
+
+    bool search(T value) const {
+        if (!root) return false;
+        Leaf* leaf = descend(value, nullptr, nullptr);
+        int pos = countBelow<false>(leaf->keys, leaf->count, value);
+        return pos < leaf->count && !(value < leaf->keys[pos]);
+    }
+
+    void remove(T value) {
+        if (!root) return;
+
+        Inner* path[MAX_LEVELS];
+        int slot[MAX_LEVELS];
+        Leaf* leaf = descend(value, path, slot);
+        int pos = countBelow<false>(leaf->keys, leaf->count, value);
+        if (pos == leaf->count || value < leaf->keys[pos]) return;
+        eraseAt(leaf->keys, leaf->count--, pos);
+
+        if (levels == 1) {
+            if (leaf->count == 0) {
+                leaves.destroy(leaf);
+                root = nullptr;
+                levels = 0;
+            }
+            return;
+        }
+        if (leaf->count >= MIN_LEAF_KEYS || !fixLeaf(leaf, path[levels - 2], slot[levels - 2])) return;
+
+        // A merge took a key from the parent; repair upwards while nodes underflow
+        for (int level = levels - 2; level > 0; level--) {
+            Inner* node = path[level];
+            if (node->count >= MIN_INNER_KEYS || !fixInner(node, path[level - 1], slot[level - 1])) return;
+        }
+        Inner* top = static_cast<Inner*>(root);
+        if (top->count == 0) {
+            root = top->children[0];
+            inners.destroy(top);
+            levels--;
+        }
+    }
+
+    // Call visit(key) for every key in [low, high], in order, along the leaf chain
+    template<typename Visit>
+    void rangeScan(T low, T high, Visit visit) const {
+        if (!root) return;
+        Leaf* leaf = descend(low, nullptr, nullptr);
+        int pos = countBelow<false>(leaf->keys, leaf->count, low);
+        for (; leaf; leaf = leaf->next, pos = 0) {
+            for (; pos < leaf->count; pos++) {
+                if (high < leaf->keys[pos]) return;
+                visit(leaf->keys[pos]);
+            }
+        }
+    }
+
+    // Number of levels, leaves included (0 when empty)
+    int getMaxDepth() const {
+        return levels;
+    }
+};
+
+// Per-node lock of ConcurrentAVLTree: one byte instead of the 40 of a std::mutex,
+// and the critical sections are only a few stores long
+class SpinLock {
+private:
+    std::atomic<bool> locked{false};
+
+public:
+    void lock() {
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            while (locked.load(std::memory_order_relaxed)) std::this_thread::yield();
+        }
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+};
+
+// Epoch-based reclamation shared by all concurrent trees. Every operation runs
+// inside a Guard, which publishes the global epoch the operation started in.
+// Unlinked nodes are retired with the epoch current at that time and deleted once
+// the global epoch is two steps further; the epoch only advances when every active
+// thread has caught up with it, so by then no operation can still hold them.
+class EpochReclaimer {
+private:
+    static const int MAX_THREADS = 256;
+    static const uint64_t IDLE = UINT64_MAX;
+    // Retirements between two attempts to advance the epoch and free nodes
+    static const size_t COLLECT_BATCH = 128;
+
+    struct Retired {
+        void* object;
+        void (*destroy)(void*);
+        uint64_t epoch;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{IDLE};
+        std::atomic<bool> claimed{false};
+        std::vector<Retired> limbo; // only touched by the thread owning the slot
+        size_t collectAt = COLLECT_BATCH;
+    };
+
+    // A thread claims a slot on first use and gives it back when it exits; the
+    // limbo list stays with the slot for its next owner
+    struct ThreadSlot {
+        Slot* slot = nullptr;
 
-    BSTNode<T>* insert(BSTNode<T>* node, T value) {
-        if (!node) return new BSTNode<T>(value);
-        if (value < node->data) node->left = insert(node->left, value);
-        else if (value > node->data) node->right = insert(node->right, value);
-        return node;
-    }
+        ThreadSlot() {
+            for (Slot& candidate : instance().slots) {
+                bool expected = false;
+                if (candidate.claimed.compare_exchange_strong(expected, true)) {
+                    slot = &candidate;
+                    return;
+                }
+            }
+            throw std::runtime_error("EpochReclaimer: too many threads");
+        }
 
-    BSTNode<T>* search(BSTNode<T>* node, T value) {
-        if (!node || node->data == value) return node;
-        if (value < node->data) return search(node->left, value);
-        return search(node->right, value);
-    }
+        ~ThreadSlot() {
+            slot->claimed.store(false, std::memory_order_release);
+        }
+    };
 
-    BSTNode<T>* findMin(BSTNode<T>* node) {
-        while (node->left) node = node->left;
-        return node;
+    std::atomic<uint64_t> globalEpoch{0};
+    Slot slots[MAX_THREADS];
+
+    EpochReclaimer() = default;
+
+    static Slot& currentSlot() {
+        thread_local ThreadSlot threadSlot;
+        return *threadSlot.slot;
     }
 
-    BSTNode<T>* remove(BSTNode<T>* node, T value) {
-        if (!node) return nullptr;
-        
-        if (value < node->data) 
-            node->left = remove(node->left, value);
-        else if (value > node->data) 
-            node->right = remove(node->right, value);
-        else {
-            if (!node->left) {
-                BSTNode<T>* temp = node->right;
-                delete node;
-                return temp;
-            } else if (!node->right) {
-                BSTNode<T>* temp = node->left;
-                delete node;
-                return temp;
-            }
-            BSTNode<T>* temp = findMin(node->right);
-            node->data = temp->data;
-            node->right = remove(node->right, temp->data);
+    void collect(Slot& slot) {
+        uint64_t epoch = globalEpoch.load();
+        bool caughtUp = true;
+        for (Slot& other : slots) {
+            uint64_t seen = other.epoch.load();
+            if (seen != IDLE && seen != epoch) {
+                caughtUp = false;
+                break;
+            }
         }
-        return node;
+        if (caughtUp) globalEpoch.compare_exchange_strong(epoch, epoch + 1);
+
+        uint64_t safe = globalEpoch.load();
+        auto pending = std::partition(slot.limbo.begin(), slot.limbo.end(),
+                                      [safe](const Retired& r) { return r.epoch + 2 > safe; });
+        for (auto it = pending; it != slot.limbo.end(); ++it) it->destroy(it->object);
+        slot.limbo.erase(pending, slot.limbo.end());
+        slot.collectAt = slot.limbo.size() + COLLECT_BATCH;
     }
 
 public:
-    BST() : root(nullptr) {}
-
-    void insert(T value) {
-        root = insert(root, value);
+    static EpochReclaimer& instance() {
+        static EpochReclaimer reclaimer;
+        return reclaimer;
     }
 
-    bool search(T value) {
-        return search(root, value) != nullptr;
+    // Runs after all other threads have finished
+    ~EpochReclaimer() {
+        for (Slot& slot : slots) {
+            for (Retired& r : slot.limbo) r.destroy(r.object);
+        }
     }
 
-    void remove(T value) {
-        root = remove(root, value);
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    class Guard {
+    private:
+        Slot& slot;
+
+    public:
+        Guard() : slot(currentSlot()) {
+            slot.epoch.store(instance().globalEpoch.load());
+        }
+
+        ~Guard() {
+            slot.epoch.store(IDLE, std::memory_order_release);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    // Delete object once no running operation can reach it; call inside a Guard
+    // after object has been unlinked
+    template<typename Object>
+    void retire(Object* object) {
+        Slot& slot = currentSlot();
+        slot.limbo.push_back({object, [](void* p) { delete static_cast<Object*>(p); }, globalEpoch.load()});
+        if (slot.limbo.size() >= slot.collectAt) collect(slot);
     }
 };
 
-// AVL Tree class
+// Concurrent AVL tree after Bronson, Casper, Chafi and Olukotun, "A Practical
+// Concurrent Binary Search Tree" (PPoPP 2010).
+//
+// Searches take no locks. They move hand over hand: a child is only entered after
+// the parent's version is re-read and found unchanged, and a rotation marks the
+// node it moves down as shrinking for its duration and bumps its version when it
+// is done, so a search that may have been misdirected notices and retries. Writers
+// lock the nodes they change, parents before children. A removed key whose node
+// has two children stays as a routing node (present == false) and is unlinked
+// once it has at most one child. Balance is relaxed: heights are repaired and
+// rotations done bottom-up after each update, and under contention the tree may
+// be briefly out of balance. Unlinked nodes go to EpochReclaimer.
 template<typename T>
-class AVLTree {
+class ConcurrentAVLTree {
 private:
-    AVLNode<T>* root;
+    // Version bits: unlinked, shrinking, and a count of finished shrinks above them
+    static const uint32_t UNLINKED = 1;
+    static const uint32_t SHRINKING = 2;
+    static const uint32_t SHRINK_COUNT = 4;
 
-    int height(AVLNode<T>* node) {
-        return node ? node->height : 0;
-    }
+    // Results of the attempt functions and of nodeCondition besides a new height
+    static const int RETRY = -1;
+    static const int DONE = 0;
+    static const int UNLINK_REQUIRED = -1;
+    static const int REBALANCE_REQUIRED = -2;
+    static const int NOTHING_REQUIRED = -3;
 
-    int getBalance(AVLNode<T>* node) {
-        return node ? height(node->left) - height(node->right) : 0;
-    }
+    // data and the links first: a search step reads little else
+    struct Node {
+        const T data;
+        std::atomic<uint32_t> version{0};
+        std::atomic<Node*> left{nullptr};
+        std::atomic<Node*> right{nullptr};
+        std::atomic<Node*> parent;
+        std::atomic<int> height;
+        std::atomic<bool> present;
+        SpinLock lock;
 
-    AVLNode<T>* rightRotate(AVLNode<T>* y) {
-        AVLNode<T>* x = y->left;
-        AVLNode<T>* T2 = x->right;
-        x->right = y;
-        y->left = T2;
-        y->height = std::max(height(y->left), height(y->right)) + 1;
-        x->height = std::max(height(x->left), height(x->right)) + 1;
-        return x;
+        Node(const T& value, bool present, Node* parent) : data(value), parent(parent), height(1), present(present) {}
+    };
+
+    // Sentinel whose right child is the root; its version never changes
+    Node holder;
+
+    static std::atomic<Node*>& child(Node* node, bool left) {
+        return left ? node->left : node->right;
     }
 
-    AVLNode<T>* leftRotate(AVLNode<T>* x) {
-        AVLNode<T>* y = x->right;
-        AVLNode<T>* T2 = y->left;
-        y->left = x;
-        x->right = T2;
-        x->height = std::max(height(x->left), height(x->right)) + 1;
-        y->height = std::max(height(y->left), height(y->right)) + 1;
-        return y;
+    static int height(Node* node) {
+        return node ? node->height.load() : 0;
     }
 
-    AVLNode<T>* insert(AVLNode<T>* node, T value) {
-        if (!node) return new AVLNode<T>(value);
+    static bool equal(const T& a, const T& b) {
+        return !(a < b) && !(b < a);
+    }
 
-        if (value < node->data)
-            node->left = insert(node->left, value);
-        else if (value > node->data)
-            node->right = insert(node->right, value);
-        else
-            return node;
+    // Spin while a rotation that started at this version is shrinking node
+    static void waitUntilShrinkCompleted(Node* node, uint32_t version) {
+        if (!(version & SHRINKING)) return;
+        while (node->version.load() == version) std::this_thread::yield();
+    }
 
-        node->height = std::max(height(node->left), height(node->right)) + 1;
-        int balance = getBalance(node);
+    // Make value present or absent below node; parent is node's parent
+    int attemptUpdate(const T& value, bool present, Node* parent, Node* node, uint32_t nodeVersion) {
+        if (equal(value, node->data)) return attemptNodeUpdate(present, parent, node);
 
-        // Left Left
-        if (balance > 1 && value < node->left->data)
-            return rightRotate(node);
+        bool left = value < node->data;
+        while (true) {
+            Node* next = child(node, left).load();
+            if (node->version.load() != nodeVersion) return RETRY;
 
-        // Right Right
-        if (balance < -1 && value > node->right->data)
-            return leftRotate(node);
+            if (!next) {
+                if (!present) return DONE;
+                Node* damaged;
+                {
+                    std::lock_guard<SpinLock> lock(node->lock);
+                    if (node->version.load() != nodeVersion) return RETRY;
+                    if (child(node, left).load()) continue; // lost a race with another insert
+                    child(node, left).store(new Node(value, true, node));
+                    damaged = fixHeight(node);
+                }
+                fixHeightAndRebalance(damaged);
+                return DONE;
+            }
 
-        // Left Right
-        if (balance > 1 && value > node->left->data) {
-            node->left = leftRotate(node->left);
-            return rightRotate(node);
+            uint32_t nextVersion = next->version.load();
+            if (nextVersion & (SHRINKING | UNLINKED)) {
+                waitUntilShrinkCompleted(next, nextVersion);
+            } else if (next == child(node, left).load()) {
+                if (node->version.load() != nodeVersion) return RETRY;
+                int result = attemptUpdate(value, present, node, next, nextVersion);
+                if (result != RETRY) return result;
+            }
         }
+    }
 
-        // Right Left
-        if (balance < -1 && value < node->right->data) {
-            node->right = rightRotate(node->right);
-            return leftRotate(node);
+    int attemptNodeUpdate(bool present, Node* parent, Node* node) {
+        if (!present && node->present.load() && (!node->left.load() || !node->right.load())) {
+            // Removal that can unlink the node: lock the parent first
+            Node* damaged;
+            {
+                std::lock_guard<SpinLock> parentLock(parent->lock);
+                if ((parent->version.load() & UNLINKED) || node->parent.load() != parent) return RETRY;
+                {
+                    std::lock_guard<SpinLock> lock(node->lock);
+                    if (!node->present.load()) return DONE;
+                    if (!attemptUnlink(parent, node)) return RETRY;
+                }
+                damaged = fixHeight(parent);
+            }
+            fixHeightAndRebalance(damaged);
+            return DONE;
         }
 
-        return node;
+        std::lock_guard<SpinLock> lock(node->lock);
+        if (node->version.load() & UNLINKED) return RETRY;
+        if (node->present.load() == present) return DONE;
+        // A child went away meanwhile, so the node should be unlinked instead
+        if (!present && (!node->left.load() || !node->right.load())) return RETRY;
+        node->present.store(present);
+        return DONE;
     }
 
-    AVLNode<T>* findMin(AVLNode<T>* node) {
-        while (node->left) node = node->left;
-        return node;
+    // parent and node locked. Splice out node if it has at most one child.
+    bool attemptUnlink(Node* parent, Node* node) {
+        Node* parentLeft = parent->left.load();
+        if (parentLeft != node && parent->right.load() != node) return false;
+        Node* left = node->left.load();
+        Node* right = node->right.load();
+        if (left && right) return false;
+
+        Node* splice = left ? left : right;
+        child(parent, parentLeft == node).store(splice);
+        if (splice) splice->parent.store(parent);
+        node->version.store(UNLINKED);
+        node->present.store(false);
+        EpochReclaimer::instance().retire(node);
+        return true;
     }
 
-    AVLNode<T>* remove(AVLNode<T>* node, T value) {
-        if (!node) return nullptr;
-
-        if (value < node->data)
-            node->left = remove(node->left, value);
-        else if (value > node->data)
-            node->right = remove(node->right, value);
-        else {
-            if (!node->left || !node->right) {
-                AVLNode<T>* temp = node->left ? node->left : node->right;
-                if (!temp) {
-                    temp = node;
-                    node = nullptr;
-                } else
-                    *node = *temp;
-                delete temp;
+    // New height of node, or which repair it needs
+    int nodeCondition(Node* node) {
+        Node* left = node->left.load();
+        Node* right = node->right.load();
+        if ((!left || !right) && !node->present.load()) return UNLINK_REQUIRED;
+
+        int hLeft = height(left);
+        int hRight = height(right);
+        int balance = hLeft - hRight;
+        if (balance < -1 || balance > 1) return REBALANCE_REQUIRED;
+        int repaired = 1 + std::max(hLeft, hRight);
+        return node->height.load() != repaired ? repaired : NOTHING_REQUIRED;
+    }
+
+    // node locked. Fix its height if that is all it needs; returns the next node
+    // needing repair, or nullptr
+    Node* fixHeight(Node* node) {
+        int condition = nodeCondition(node);
+        if (condition == REBALANCE_REQUIRED || condition == UNLINK_REQUIRED) return node;
+        if (condition == NOTHING_REQUIRED) return nullptr;
+        node->height.store(condition);
+        return node->parent.load();
+    }
+
+    // Repair upwards from node until nothing is left to do
+    void fixHeightAndRebalance(Node* node) {
+        while (node && node->parent.load()) {
+            int condition = nodeCondition(node);
+            if (condition == NOTHING_REQUIRED || (node->version.load() & UNLINKED)) return;
+
+            if (condition != UNLINK_REQUIRED && condition != REBALANCE_REQUIRED) {
+                std::lock_guard<SpinLock> lock(node->lock);
+                node = fixHeight(node);
             } else {
-                AVLNode<T>* temp = findMin(node->right);
-                node->data = temp->data;
-                node->right = remove(node->right, temp->data);
+                Node* parent = node->parent.load();
+                std::lock_guard<SpinLock> parentLock(parent->lock);
+                if (!(parent->version.load() & UNLINKED) && node->parent.load() == parent) {
+                    std::lock_guard<SpinLock> lock(node->lock);
+                    node = rebalance(parent, node);
+                }
+            }
+        }
+    }
+
+    // parent and n locked. Unlink, rotate or fix the height of n
+    Node* rebalance(Node* parent, Node* n) {
+        Node* left = n->left.load();
+        Node* right = n->right.load();
+        if ((!left || !right) && !n->present.load()) {
+            return attemptUnlink(parent, n) ? fixHeight(parent) : n;
+        }
+
+        int hLeft = height(left);
+        int hRight = height(right);
+        int balance = hLeft - hRight;
+        if (balance > 1) return rebalanceFrom(parent, n, left, hRight, true);
+        if (balance < -1) return rebalanceFrom(parent, n, right, hLeft, false);
+
+        int repaired = 1 + std::max(hLeft, hRight);
+        if (repaired == n->height.load()) return nullptr;
+        n->height.store(repaired);
+        return fixHeight(parent);
+    }
+
+    // n is too tall on side `left` (child c) against a light side of height hLight.
+    // Rotate c up, with a double rotation when c leans the other way and would be
+    // balanced afterwards.
+    Node* rebalanceFrom(Node* parent, Node* n, Node* c, int hLight, bool left) {
+        std::lock_guard<SpinLock> lock(c->lock);
+        if (c->height.load() - hLight <= 1) return n;
+
+        Node* inner = child(c, !left).load();
+        int hOuter = height(child(c, left).load());
+        int hInner = height(inner);
+        if (hOuter >= hInner) return rotate(parent, n, c, left, hLight, hOuter, inner, hInner);
+
+        {
+            std::lock_guard<SpinLock> innerLock(inner->lock);
+            hInner = inner->height.load();
+            if (hOuter >= hInner) return rotate(parent, n, c, left, hLight, hOuter, inner, hInner);
+
+            int hInnerNear = height(child(inner, left).load());
+            int balance = hOuter - hInnerNear;
+            if (balance >= -1 && balance <= 1) {
+                return rotateDouble(parent, n, c, left, hLight, hOuter, inner, hInnerNear);
             }
         }
+        // c would stay unbalanced; fix it first, n is rebalanced later if needed
+        return rebalanceFrom(n, c, inner, hOuter, !left);
+    }
 
-        if (!node) return nullptr;
+    // Single rotation lifting c (child of n on side `left`) over n. Returns the
+    // deepest node that still needs repair. Routing nodes left with one child are
+    // unlinked at once, while they and their new parents are still locked: handing
+    // them back for repair would skip fixing the height of parent, and the paper's
+    // variant of avoiding them leaves n unbalanced once updates stop.
+    Node* rotate(Node* parent, Node* n, Node* c, bool left, int hLight, int hOuter, Node* inner, int hInner) {
+        uint32_t version = n->version.load();
+        bool parentLeft = parent->left.load() == n;
 
-        node->height = std::max(height(node->left), height(node->right)) + 1;
-        int balance = getBalance(node);
+        // Links out of the shrinking node change first, the link into it last
+        n->version.store(version | SHRINKING);
+        child(n, left).store(inner);
+        child(c, !left).store(n);
+        child(parent, parentLeft).store(c);
 
-        // Left Left
-        if (balance > 1 && getBalance(node->left) >= 0)
-            return rightRotate(node);
+        c->parent.store(parent);
+        n->parent.store(c);
+        if (inner) inner->parent.store(n);
 
-        // Left Right
-        if (balance > 1 && getBalance(node->left) < 0) {
-            node->left = leftRotate(node->left);
-            return rightRotate(node);
+        int hN = 1 + std::max(hInner, hLight);
+        n->height.store(hN);
+        c->height.store(1 + std::max(hOuter, hN));
+        n->version.store(version + SHRINK_COUNT);
+
+        if ((!inner || hLight == 0) && !n->present.load()) {
+            attemptUnlink(c, n);
+            hN = std::max(hInner, hLight);
+            c->height.store(1 + std::max(hOuter, hN));
+        } else {
+            int balanceN = hInner - hLight;
+            if (balanceN < -1 || balanceN > 1) return n;
+        }
+        if (hOuter == 0 && !c->present.load()) {
+            attemptUnlink(parent, c);
+            return fixHeight(parent);
         }
+        int balanceC = hOuter - hN;
+        if (balanceC < -1 || balanceC > 1) return c;
+        return fixHeight(parent);
+    }
 
-        // Right Right
-        if (balance < -1 && getBalance(node->right) <= 0)
-            return leftRotate(node);
+    // Double rotation lifting g, the inner child of c, over both c and n
+    Node* rotateDouble(Node* parent, Node* n, Node* c, bool left, int hLight, int hOuter, Node* g, int hNear) {
+        uint32_t version = n->version.load();
+        uint32_t childVersion = c->version.load();
+        bool parentLeft = parent->left.load() == n;
+        Node* near = child(g, left).load(); // moves under c
+        Node* far = child(g, !left).load(); // moves under n
+        int hFar = height(far);
 
-        // Right Left
-        if (balance < -1 && getBalance(node->right) > 0) {
-            node->right = rightRotate(node->right);
-            return leftRotate(node);
+        n->version.store(version | SHRINKING);
+        c->version.store(childVersion | SHRINKING);
+        child(n, left).store(far);
+        child(c, !left).store(near);
+        child(g, left).store(c);
+        child(g, !left).store(n);
+        child(parent, parentLeft).store(g);
+
+        g->parent.store(parent);
+        c->parent.store(g);
+        n->parent.store(g);
+        if (far) far->parent.store(n);
+        if (near) near->parent.store(c);
+
+        int hN = 1 + std::max(hFar, hLight);
+        n->height.store(hN);
+        int hC = 1 + std::max(hOuter, hNear);
+        c->height.store(hC);
+        g->height.store(1 + std::max(hC, hN));
+        c->version.store(childVersion + SHRINK_COUNT);
+        n->version.store(version + SHRINK_COUNT);
+
+        if ((hOuter == 0 || !near) && !c->present.load()) {
+            attemptUnlink(g, c);
+            hC = std::max(hOuter, hNear);
         }
+        if ((!far || hLight == 0) && !n->present.load()) {
+            attemptUnlink(g, n);
+            hN = std::max(hFar, hLight);
+        } else {
+            int balanceN = hFar - hLight;
+            if (balanceN < -1 || balanceN > 1) return n;
+        }
+        g->height.store(1 + std::max(hC, hN));
 
-        return node;
+        int balanceG = hC - hN;
+        if (balanceG < -1 || balanceG > 1) return g;
+        return fixHeight(parent);
     }
 
-    AVLNode<T>* search(AVLNode<T>* node, T value) {
-        if (!node || node->data == value) return node;
-        if (value < node->data) return search(node->left, value);
-        return search(node->right, value);
+    void update(const T& value, bool present) {
+        EpochReclaimer::Guard guard;
+        while (true) {
+            Node* root = holder.right.load();
+            if (!root) {
+                if (!present) return;
+                std::lock_guard<SpinLock> lock(holder.lock);
+                if (!holder.right.load()) {
+                    holder.right.store(new Node(value, true, &holder));
+                    return;
+                }
+                continue;
+            }
+
+            uint32_t version = root->version.load();
+            if (version & (SHRINKING | UNLINKED)) {
+                waitUntilShrinkCompleted(root, version);
+            } else if (root == holder.right.load()) {
+                if (attemptUpdate(value, present, &holder, root, version) != RETRY) return;
+            }
+        }
     }
 
 public:
-    AVLTree() : root(nullptr) {}
+    ConcurrentAVLTree() : holder(T(), false, nullptr) {}
+
+    // Not thread-safe; all other threads must be done with the tree
+    ~ConcurrentAVLTree() {
+        std::vector<Node*> stack;
+        if (Node* root = holder.right.load()) stack.push_back(root);
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            if (Node* left = node->left.load()) stack.push_back(left);
+            if (Node* right = node->right.load()) stack.push_back(right);
+            delete node;
+        }
+    }
+
+    ConcurrentAVLTree(const ConcurrentAVLTree&) = delete;
+    ConcurrentAVLTree& operator=(const ConcurrentAVLTree&) = delete;
 
     void insert(T value) {
-        root = insert(root, value);
+        update(value, true);
     }
 
+    // Iterative, and a failed validation starts over from the root rather than
+    // from the last valid ancestor as in the paper: retries are rare, and the loop
+    // compiles to a child select without a branch on the comparison
     bool search(T value) {
-        return search(root, value) != nullptr;
+        EpochReclaimer::Guard guard;
+        while (true) {
+            Node* node = holder.right.load();
+            if (!node) return false;
+            uint32_t nodeVersion = node->version.load();
+            if (nodeVersion & (SHRINKING | UNLINKED)) {
+                waitUntilShrinkCompleted(node, nodeVersion);
+                continue;
+            }
+            if (node != holder.right.load()) continue;
+
+            while (true) {
+                if (equal(value, node->data)) return node->present.load();
+                Node* left = node->left.load();
+                Node* right = node->right.load();
+                Node* next = value < node->data ? left : right;
+                if (!next) {
+                    if (node->version.load() == nodeVersion) return false;
+                    break;
+                }
+
+                uint32_t nextVersion = next->version.load();
+                if (nextVersion & (SHRINKING | UNLINKED)) {
+                    waitUntilShrinkCompleted(next, nextVersion);
+                    // node may have been unlinked itself, leaving its child link
+                    // stale for good; rereading it without this check spins forever
+                    if (node->version.load() != nodeVersion) break;
+                    continue;
+                }
+                if (node->version.load() != nodeVersion) break;
+                node = next;
+                nodeVersion = nextVersion;
+            }
+        }
     }
 
     void remove(T value) {
-        root = remove(root, value);
+        update(value, false);
+    }
+
+    // Height of the tree; only exact while no update is running
+    int getMaxDepth() {
+        return height(holder.right.load());
+    }
+};
+
+// Resident set size of this process in KB
+long residentKb() {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Run measure() in a child process so every run starts from the same heap, and
+// return the count values it produced (zeros if the child failed)
+template<typename Measure>
+std::vector<double> measureInChild(size_t count, Measure measure) {
+    int fds[2];
+    if (pipe(fds) != 0) return std::vector<double>(count, 0);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        std::vector<double> result = measure();
+        result.resize(count);
+        ssize_t bytes = count * sizeof(double);
+        ssize_t written = write(fds[1], result.data(), bytes);
+        _exit(written == bytes ? 0 : 1);
+    }
+
+    close(fds[1]);
+    std::vector<double> result(count, 0);
+    ssize_t got = read(fds[0], result.data(), count * sizeof(double));
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+    if (got != ssize_t(count * sizeof(double))) return std::vector<double>(count, 0);
+    return result;
+}
+
+// Fill a fresh tree in a child process.
+// Returns insert time (us), growth of resident memory (KB) and teardown time (us).
+template<typename Tree>
+std::vector<double> measureFill(const std::vector<int>& data) {
+    return measureInChild(3, [&]() {
+        long before = residentKb();
+        auto* tree = new Tree();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int val : data) {
+            tree->insert(val);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        long after = residentKb();
+
+        auto teardownStart = std::chrono::high_resolution_clock::now();
+        delete tree;
+        auto teardownEnd = std::chrono::high_resolution_clock::now();
+
+        return std::vector<double>{
+            (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+            (double)(after - before),
+            (double)std::chrono::duration_cast<std::chrono::microseconds>(teardownEnd - teardownStart).count()
+        };
+    });
+}
+
+// Insert time, memory and teardown with the node arena against one new per node
+void benchmarkNodeAllocation(std::ofstream& outFile, std::mt19937& gen) {
+    outFile << "\nNode allocation (random keys)\n";
+    outFile << "Size\tTree\tAllocator\tInsert (us)\tMemory (KB)\tTeardown (us)\n";
+
+    for (int exponent : {16, 20, 22}) {
+        int size = 1 << exponent;
+        std::vector<int> data(size);
+        std::uniform_int_distribution<> dis(1, size * 10);
+        for (int& val : data) {
+            val = dis(gen);
+        }
+
+        auto report = [&](const char* tree, const char* allocator, const std::vector<double>& r) {
+            outFile << size << "\t" << tree << "\t" << allocator << "\t\t"
+                    << (long long)r[0] << "\t\t" << (long long)r[1] << "\t\t" << (long long)r[2] << "\n";
+        };
+        report("BST", "new/delete", measureFill<BST<int, HeapNodes>>(data));
+        report("BST", "arena", measureFill<BST<int, NodeArena>>(data));
+        report("AVL", "new/delete", measureFill<AVLTree<int, HeapNodes>>(data));
+        report("AVL", "arena", measureFill<AVLTree<int, NodeArena>>(data));
+    }
+}
+
+// Building an AVL tree from a range against inserting the values one by one,
+// and merging a batch into an existing tree against repeated inserts
+void benchmarkBulkLoad(std::ofstream& outFile, std::mt19937& gen) {
+    outFile << "\nBulk loading (AVL)\n";
+    outFile << "Size\tInput\tInsert loop (us)\tBulk (us)\tHeight loop\tHeight bulk\n";
+
+    auto elapsed = [](auto&& action) {
+        auto start = std::chrono::high_resolution_clock::now();
+        action();
+        auto end = std::chrono::high_resolution_clock::now();
+        return (long long)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    };
+
+    for (int exponent : {16, 20, 22}) {
+        int size = 1 << exponent;
+        std::vector<int> sorted(size);
+        for (int i = 0; i < size; i++) {
+            sorted[i] = i * 2;
+        }
+        std::vector<int> shuffled = sorted;
+        std::shuffle(shuffled.begin(), shuffled.end(), gen);
+
+        auto report = [&](const char* input, long long loop, long long bulk, int loopHeight, int bulkHeight) {
+            outFile << size << "\t" << input << "\t" << loop << "\t\t" << bulk << "\t\t"
+                    << loopHeight << "\t\t" << bulkHeight << "\n";
+        };
+
+        for (const std::vector<int>* data : {&sorted, &shuffled}) {
+            AVLTree<int> loopTree, bulkTree;
+            long long loop = elapsed([&]() {
+                for (int val : *data) loopTree.insert(val);
+            });
+            long long bulk = elapsed([&]() { bulkTree.buildFrom(data->begin(), data->end()); });
+            report(data == &sorted ? "sorted" : "random", loop, bulk,
+                   loopTree.getMaxDepth(), bulkTree.getMaxDepth());
+        }
+
+        // Merge a batch of a quarter of the tree size, half of it new keys
+        std::vector<int> batch(size / 4);
+        std::uniform_int_distribution<> dis(0, size * 2);
+        for (int& val : batch) {
+            val = dis(gen);
+        }
+
+        AVLTree<int> loopTree, bulkTree;
+        loopTree.buildFrom(sorted.begin(), sorted.end());
+        bulkTree.buildFrom(sorted.begin(), sorted.end());
+        long long loop = elapsed([&]() {
+            for (int val : batch) loopTree.insert(val);
+        });
+        long long bulk = elapsed([&]() { bulkTree.bulkInsert(batch.begin(), batch.end()); });
+        report("batch n/4", loop, bulk, loopTree.getMaxDepth(), bulkTree.getMaxDepth());
+    }
+}
+
+// Scalar search loop against searchBatch on trees from L2-sized to far beyond L3
+void benchmarkBatchSearch(std::ofstream& outFile, std::mt19937& gen) {
+    outFile << "\nBatched search (random keys, 2^20 lookups)\n";
+    outFile << "Size\tTree\tLoop (ns/key)\tBatch (ns/key)\tSpeedup\n";
+
+    const int LOOKUPS = 1 << 20;
+    for (int exponent : {16, 20, 24}) {
+        int size = 1 << exponent;
+        std::vector<int> data(size);
+        std::uniform_int_distribution<> dis(1, size * 10);
+        for (int& val : data) {
+            val = dis(gen);
+        }
+        std::vector<int> keys(LOOKUPS);
+        for (int& key : keys) {
+            key = dis(gen);
+        }
+
+        auto measure = [&](const char* name, auto& tree) {
+            for (int val : data) {
+                tree.insert(val);
+            }
+
+            size_t hits = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int key : keys) {
+                hits += tree.search(key);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            double loop = std::chrono::duration<double, std::nano>(end - start).count() / LOOKUPS;
+
+            std::vector<bool> results;
+            start = std::chrono::high_resolution_clock::now();
+            tree.searchBatch(keys, results);
+            end = std::chrono::high_resolution_clock::now();
+            double batch = std::chrono::duration<double, std::nano>(end - start).count() / LOOKUPS;
+
+            size_t batchHits = std::count(results.begin(), results.end(), true);
+            if (batchHits != hits) {
+                outFile << "WARNING: batch found " << batchHits << " keys, loop " << hits << "\n";
+            }
+            outFile << size << "\t" << name << "\t" << loop << "\t\t" << batch << "\t\t" << loop / batch << "\n";
+        };
+
+        BST<int> bst;
+        measure("BST", bst);
+        bst.clear();
+        AVLTree<int> avl;
+        measure("AVL", avl);
+    }
+}
+
+// Order statistics and in-order iteration on AVL trees of random keys
+void benchmarkOrderStatistics(std::ofstream& outFile, std::mt19937& gen) {
+    outFile << "\nOrder statistics (AVL, random keys)\n";
+    outFile << "Size\tRank (ns)\tSelect (ns)\tCount range (ns)\tRange scan (ns/key)\n";
+
+    const int QUERIES = 1 << 16;
+    const int SCAN_LENGTH = 100;
+    for (int exponent : {16, 20, 22}) {
+        int size = 1 << exponent;
+        std::uniform_int_distribution<> dis(1, size * 10);
+        AVLTree<int> avl;
+        for (int i = 0; i < size; i++) {
+            avl.insert(dis(gen));
+        }
+        std::vector<int> keys(QUERIES);
+        for (int& key : keys) {
+            key = dis(gen);
+        }
+        std::uniform_int_distribution<size_t> rankDis(0, avl.size() - 1);
+        std::vector<size_t> ranks(QUERIES);
+        for (size_t& k : ranks) {
+            k = rankDis(gen);
+        }
+
+        size_t sink = 0;
+        auto nsPer = [](auto start, auto end, double count) {
+            return std::chrono::duration<double, std::nano>(end - start).count() / count;
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int key : keys) {
+            sink += avl.rank(key);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double rankTime = nsPer(start, end, QUERIES);
+
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t k : ranks) {
+            sink += avl.select(k);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double selectTime = nsPer(start, end, QUERIES);
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int key : keys) {
+            sink += avl.countRange(key, key + size);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double countTime = nsPer(start, end, QUERIES);
+
+        size_t scanned = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (int key : keys) {
+            auto it = avl.lowerBound(key);
+            for (int step = 0; step < SCAN_LENGTH && it != avl.end(); step++, ++it) {
+                sink += *it;
+                scanned++;
+            }
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double scanTime = nsPer(start, end, scanned);
+
+        outFile << size << "\t" << rankTime << "\t\t" << selectTime << "\t\t" << countTime << "\t\t"
+                << scanTime << "\n";
+
+        // Keep the results alive so the queries cannot be optimised away
+        [[maybe_unused]] volatile size_t checksum = sink;
+    }
+}
+
+// Many threads on a few keys, where searches keep running into nodes that are
+// being unlinked. Every thread updates only its own keys (key % threads) but
+// searches all of them; afterwards each key must be present exactly when its
+// owner last inserted it. A hang here is a livelock in the tree.
+void stressConcurrentAVL(std::ofstream& outFile) {
+    const int THREADS = 8;
+    const int OPS_PER_THREAD = 100000;
+
+    outFile << "\nConcurrent AVL stress check (" << THREADS << " threads, " << OPS_PER_THREAD
+            << " mixed ops each)\n";
+    for (int keyRange : {64, 1024}) {
+        ConcurrentAVLTree<int> tree;
+        std::vector<std::vector<char>> owned(THREADS, std::vector<char>(keyRange, 0));
+        std::vector<std::thread> workers;
+        for (int t = 0; t < THREADS; t++) {
+            workers.emplace_back([&, t]() {
+                std::mt19937 local(t + keyRange);
+                std::uniform_int_distribution<> dis(0, keyRange - 1);
+                for (int i = 0; i < OPS_PER_THREAD; i++) {
+                    int key = dis(local);
+                    int kind = local() % 3;
+                    if (kind == 0 || key % THREADS != t) {
+                        tree.search(key);
+                    } else if (kind == 1) {
+                        tree.insert(key);
+                        owned[t][key] = 1;
+                    } else {
+                        tree.remove(key);
+                        owned[t][key] = 0;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        int wrong = 0;
+        for (int key = 0; key < keyRange; key++) {
+            wrong += tree.search(key) != bool(owned[key % THREADS][key]);
+        }
+        outFile << "Keys " << keyRange << ": " << (wrong ? "FAILED, " + std::to_string(wrong) + " keys wrong" : "ok")
+                << ", depth " << tree.getMaxDepth() << "\n";
+    }
+}
+
+// Mixed lookups and updates from 1 to N threads: ConcurrentAVLTree against the
+// single-threaded AVLTree behind a reader/writer lock
+void benchmarkConcurrentAVL(std::ofstream& outFile, std::mt19937& gen) {
+    const int KEY_RANGE = 1 << 20;
+    const int OPS_PER_THREAD = 1 << 18;
+    // Powers of two, ending with the core count when it is not one of them
+    std::vector<int> threadCounts;
+    int cores = std::thread::hardware_concurrency();
+    for (int threads = 1; threads <= std::max(8, cores); threads *= 2) threadCounts.push_back(threads);
+    if (cores > threadCounts.back()) threadCounts.push_back(cores);
+
+    outFile << "\nConcurrent AVL (" << KEY_RANGE / 2 << " keys, " << OPS_PER_THREAD << " ops per thread, "
+            << std::thread::hardware_concurrency() << " cores)\n";
+    outFile << "Threads\tWrites %\tConcurrent (Mops/s)\tLocked AVL (Mops/s)\n";
+
+    std::uniform_int_distribution<> dis(0, KEY_RANGE - 1);
+    std::vector<int> initial(KEY_RANGE / 2);
+    for (int& key : initial) {
+        key = dis(gen);
+    }
+
+    for (int writePercent : {0, 10, 50}) {
+        for (int threads : threadCounts) {
+            // Each thread replays its own pre-generated operations: 0 search, 1 insert, 2 remove
+            std::vector<std::vector<std::pair<int, int>>> ops(threads);
+            std::uniform_int_distribution<> percent(0, 99);
+            for (auto& list : ops) {
+                list.resize(OPS_PER_THREAD);
+                for (auto& op : list) {
+                    op.first = percent(gen) < writePercent ? 1 + percent(gen) % 2 : 0;
+                    op.second = dis(gen);
+                }
+            }
+
+            auto run = [&](auto& tree, auto&& search, auto&& insert, auto&& remove) {
+                for (int key : initial) {
+                    tree.insert(key);
+                }
+                std::atomic<size_t> hits{0};
+                auto start = std::chrono::high_resolution_clock::now();
+                std::vector<std::thread> workers;
+                for (int t = 0; t < threads; t++) {
+                    workers.emplace_back([&, t]() {
+                        size_t found = 0;
+                        for (const auto& op : ops[t]) {
+                            if (op.first == 0) found += search(op.second);
+                            else if (op.first == 1) insert(op.second);
+                            else remove(op.second);
+                        }
+                        hits += found;
+                    });
+                }
+                for (auto& worker : workers) worker.join();
+                auto end = std::chrono::high_resolution_clock::now();
+                double seconds = std::chrono::duration<double>(end - start).count();
+                return threads * (double)OPS_PER_THREAD / seconds / 1e6;
+            };
+
+            ConcurrentAVLTree<int> concurrent;
+            double concurrentRate = run(concurrent,
+                [&](int key) { return concurrent.search(key); },
+                [&](int key) { concurrent.insert(key); },
+                [&](int key) { concurrent.remove(key); });
+
+            AVLTree<int> locked;
+            std::shared_mutex lock;
+            double lockedRate = run(locked,
+                [&](int key) { std::shared_lock<std::shared_mutex> guard(lock); return locked.search(key); },
+                [&](int key) { std::unique_lock<std::shared_mutex> guard(lock); locked.insert(key); },
+                [&](int key) { std::unique_lock<std::shared_mutex> guard(lock); locked.remove(key); });
+
+            outFile << threads << "\t" << writePercent << "\t\t" << concurrentRate << "\t\t" << lockedRate << "\n";
+        }
+    }
+}
+
+// Allocations made through CountingAllocator since the program started
+size_t countedAllocations = 0;
+
+// std::allocator that counts its allocations; a string using it counts its own
+// buffer allocations, so every copy of a long key shows up
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        countedAllocations++;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U>&) const {
+        return false;
     }
 };
 
+using CountedString = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+// String keys too long for the small-string buffer: AVLTree<string>, which takes
+// keys by value, against AVLMap and std::map with std::less<> looking up by
+// string_view. Nodes of all three come from the heap.
+void benchmarkStringKeys(std::ofstream& outFile, std::mt19937& gen) {
+    outFile << "\nString keys (32 chars, 2^16 lookups)\n";
+    outFile << "Size\tContainer\tInsert (ns)\tKey allocs/insert\tSearch (ns)\tKey allocs/search\n";
+
+    const int LOOKUPS = 1 << 16;
+    for (int exponent : {12, 16, 20}) {
+        int size = 1 << exponent;
+        std::uniform_int_distribution<uint64_t> dis;
+        auto makeKey = [&]() {
+            char key[33];
+            snprintf(key, sizeof(key), "customer/%016llx/order", (unsigned long long)dis(gen));
+            return std::string(key);
+        };
+        std::vector<std::string> keys(size);
+        for (std::string& key : keys) {
+            key = makeKey();
+        }
+        // Half hits, half misses
+        std::vector<std::string> probes(LOOKUPS);
+        std::uniform_int_distribution<int> pick(0, size - 1);
+        for (int i = 0; i < LOOKUPS; i++) {
+            probes[i] = i % 2 ? keys[pick(gen)] : makeKey();
+        }
+
+        // Each container runs in a child process on a fresh heap, so the node and key
+        // layout does not depend on what the previous run freed
+        auto run = [&](const char* name, auto makeContainer, auto&& insert, auto&& search) {
+            std::vector<double> r = measureInChild(4, [&]() {
+                auto container = makeContainer();
+                size_t before = countedAllocations;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < size; i++) {
+                    insert(container, std::string_view(keys[i]), i);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                double insertTime = std::chrono::duration<double, std::nano>(end - start).count() / size;
+                double insertAllocs = double(countedAllocations - before) / size;
+
+                size_t hits = 0;
+                before = countedAllocations;
+                start = std::chrono::high_resolution_clock::now();
+                for (const std::string& probe : probes) {
+                    hits += search(container, std::string_view(probe));
+                }
+                end = std::chrono::high_resolution_clock::now();
+                double searchTime = std::chrono::duration<double, std::nano>(end - start).count() / LOOKUPS;
+                double searchAllocs = double(countedAllocations - before) / LOOKUPS;
+
+                [[maybe_unused]] volatile size_t checksum = hits;
+                return std::vector<double>{insertTime, insertAllocs, searchTime, searchAllocs};
+            });
+            outFile << size << "\t" << name << "\t" << r[0] << "\t\t" << r[1] << "\t\t\t"
+                    << r[2] << "\t\t" << r[3] << "\n";
+        };
+
+        using Tree = AVLTree<CountedString, HeapNodes>;
+        using Map = AVLMap<CountedString, int, std::less<>>;
+        using StdMap = std::map<CountedString, int, std::less<>>;
+        run("AVLTree", []() { return std::make_unique<Tree>(); },
+            [](auto& tree, std::string_view key, int) { tree->insert(CountedString(key)); },
+            [](auto& tree, std::string_view key) { return tree->search(CountedString(key)); });
+        run("AVLMap", []() { return std::make_unique<Map>(); },
+            [](auto& map, std::string_view key, int value) { map->try_emplace(key, value); },
+            [](auto& map, std::string_view key) { return map->contains(key); });
+        // std::map::try_emplace has no heterogeneous overload before C++26
+        run("std::map", []() { return std::make_unique<StdMap>(); },
+            [](auto& map, std::string_view key, int value) { map->try_emplace(CountedString(key), value); },
+            [](auto& map, std::string_view key) { return map->find(key) != map->end(); });
+    }
+}
+
 int main() {
     std::random_device rd;
     std::mt19937 gen(rd());
+
+    // Search results go here so the lookups cannot be optimised away
+    [[maybe_unused]] volatile bool found = false;
     
     std::ofstream outFile("results.txt");
     if (!outFile) {
@@ -247,10 +2476,14 @@ int main() {
         return 1;
     }
 
-    outFile << "Size\tType\tBST Insert\tAVL Insert\tBST Search\tAVL Search\tArray Search\tBST Delete\tAVL Delete\n";
+    outFile << "Size\tType\tBST Insert\tAVL Insert\tBST Search\tAVL Search\tArray Search\tScan Search\tFrozen Search\tBST Delete\tAVL Delete\tB+64 Insert\tB+64 Search\tB+64 Delete\tB+256 Insert\tB+256 Search\tB+256 Delete\n";
+
+    // 15 test series, 2^10 ... 2^24 elements
+    const int NUM_SERIES = 15;
+    // BST insertion of sorted keys is quadratic, so its sorted cycles stop here
+    const int BST_SORTED_LIMIT = 1 << 14;
 
-    // 10 test series
-    for (int series = 0; series < 10; series++) {
+    for (int series = 0; series < NUM_SERIES; series++) {
         int size = std::pow(2, 10 + series);
         
         // 20 cycles (10 random + 10 sorted)
@@ -273,11 +2506,14 @@ int main() {
 
             BST<int> bst;
             AVLTree<int> avl;
+            bool run_bst = cycle < 10 || size <= BST_SORTED_LIMIT;
 
             // Measure insertion time
             auto start = std::chrono::high_resolution_clock::now();
-            for (int val : data) {
-                bst.insert(val);
+            if (run_bst) {
+                for (int val : data) {
+                    bst.insert(val);
+                }
             }
             auto end = std::chrono::high_resolution_clock::now();
             auto bst_insert_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
@@ -298,15 +2534,17 @@ int main() {
 
             // Measure search time
             start = std::chrono::high_resolution_clock::now();
-            for (int val : search_values) {
-                bst.search(val);
+            if (run_bst) {
+                for (int val : search_values) {
+                    found = bst.search(val);
+                }
             }
             end = std::chrono::high_resolution_clock::now();
             auto bst_search_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
 
             start = std::chrono::high_resolution_clock::now();
             for (int val : search_values) {
-                avl.search(val);
+                found = avl.search(val);
             }
             end = std::chrono::high_resolution_clock::now();
             auto avl_search_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
@@ -314,15 +2552,34 @@ int main() {
             // Array search time
             start = std::chrono::high_resolution_clock::now();
             for (int val : search_values) {
-                std::find(data.begin(), data.end(), val);
+                found = std::find(data.begin(), data.end(), val) != data.end();
             }
             end = std::chrono::high_resolution_clock::now();
             auto array_search_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
 
-            // Measure deletion time
+            // The same unsorted array with the vectorised scan
+            start = std::chrono::high_resolution_clock::now();
+            for (int val : search_values) {
+                found = linearScan(data.data(), data.size(), val);
+            }
+            end = std::chrono::high_resolution_clock::now();
+            auto scan_search_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+
+            // Frozen copy of the AVL tree
+            EytzingerArray<int> frozen = avl.freeze();
             start = std::chrono::high_resolution_clock::now();
             for (int val : search_values) {
-                bst.remove(val);
+                found = frozen.search(val);
+            }
+            end = std::chrono::high_resolution_clock::now();
+            auto frozen_search_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+
+            // Measure deletion time
+            start = std::chrono::high_resolution_clock::now();
+            if (run_bst) {
+                for (int val : search_values) {
+                    bst.remove(val);
+                }
             }
             end = std::chrono::high_resolution_clock::now();
             auto bst_delete_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
@@ -334,18 +2591,71 @@ int main() {
             end = std::chrono::high_resolution_clock::now();
             auto avl_delete_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
 
+            // B+-trees with 64- and 256-byte nodes go through the same steps
+            auto run_btree = [&](auto& tree) {
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int val : data) {
+                    tree.insert(val);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                double insert_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+                start = std::chrono::high_resolution_clock::now();
+                for (int val : search_values) {
+                    found = tree.search(val);
+                }
+                end = std::chrono::high_resolution_clock::now();
+                double search_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+
+                start = std::chrono::high_resolution_clock::now();
+                for (int val : search_values) {
+                    tree.remove(val);
+                }
+                end = std::chrono::high_resolution_clock::now();
+                double delete_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+                return std::vector<double>{insert_time, search_time, delete_time};
+            };
+            BPlusTree<int, 64> btree64;
+            BPlusTree<int, 256> btree256;
+            std::vector<double> btree64_times = run_btree(btree64);
+            std::vector<double> btree256_times = run_btree(btree256);
+
+            // Skipped BST cycles are reported as "-"
+            auto bst_column = [&](double time) {
+                std::ostringstream text;
+                if (run_bst) text << time;
+                else text << "-";
+                return text.str();
+            };
+
             outFile << size << "\t" 
                    << (cycle < 10 ? "Random" : "Sorted") << "\t"
-                   << bst_insert_time << "\t\t"
+                   << bst_column(bst_insert_time) << "\t\t"
                    << avl_insert_time << "\t\t"
-                   << bst_search_time << "\t\t"
+                   << bst_column(bst_search_time) << "\t\t"
                    << avl_search_time << "\t\t"
                    << array_search_time << "\t\t"
-                   << bst_delete_time << "\t\t"
-                   << avl_delete_time << "\n";
+                   << scan_search_time << "\t\t"
+                   << frozen_search_time << "\t\t"
+                   << bst_column(bst_delete_time) << "\t\t"
+                   << avl_delete_time << "\t\t"
+                   << (long long)btree64_times[0] << "\t\t"
+                   << btree64_times[1] << "\t\t"
+                   << btree64_times[2] << "\t\t"
+                   << (long long)btree256_times[0] << "\t\t"
+                   << btree256_times[1] << "\t\t"
+                   << btree256_times[2] << "\n";
         }
     }
 
+    benchmarkNodeAllocation(outFile, gen);
+    benchmarkBulkLoad(outFile, gen);
+    benchmarkBatchSearch(outFile, gen);
+    benchmarkOrderStatistics(outFile, gen);
+    stressConcurrentAVL(outFile);
+    benchmarkConcurrentAVL(outFile, gen);
+    benchmarkStringKeys(outFile, gen);
+
     outFile.close();
     return 0;
 }
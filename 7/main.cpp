@@ -7,6 +7,17 @@
 #include <fstream>
 #include <cmath>
 #include <queue>
+#include <thread>
+#include <tuple>
+#include <climits>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/wait.h>
 
 // AVL Tree Node
 template<typename T>
@@ -28,11 +39,128 @@ struct TreapNode {
     TreapNode(T value, int p) : data(value), priority(p), left(nullptr), right(nullptr) {}
 };
 
+// Kinds of public operation the trees keep counters for
+enum TreeOperation { OP_INSERT, OP_REMOVE, OP_SEARCH, OP_SCAN, OP_SET, OP_BUILD, OPERATION_COUNT };
+
+// AVL rebalancing cases; a double rotation counts once
+enum RotationCase { ROTATE_LL, ROTATE_RR, ROTATE_LR, ROTATE_RL, ROTATION_CASES };
+
+// Default counter policy of AVLTree and Treap. Every hook is empty, so the trees
+// compile to the same code as without counters.
+struct NoStats {
+    static const bool ENABLED = false;
+
+    void begin(TreeOperation) {}
+    void compare() {}
+    void visit() {}
+    void rotate(RotationCase) {}
+    void split() {}
+    void merge() {}
+    void allocate() {}
+    void release() {}
+};
+
+// Counters kept per kind of public operation: key comparisons, nodes visited,
+// rotations by case, split and merge calls (recursive steps included), node
+// allocations and frees. Not thread-safe, so trees using it run set operations
+// and bulk inserts on one thread.
+struct OperationStats {
+    static const bool ENABLED = true;
+
+    struct Counts {
+        unsigned long long calls = 0;
+        unsigned long long comparisons = 0;
+        unsigned long long visits = 0;
+        unsigned long long rotations[ROTATION_CASES] = {};
+        unsigned long long splits = 0;
+        unsigned long long merges = 0;
+        unsigned long long allocations = 0;
+        unsigned long long frees = 0;
+    };
+
+    Counts counts[OPERATION_COUNT];
+    TreeOperation current = OP_INSERT;
+
+    void begin(TreeOperation operation) {
+        current = operation;
+        counts[operation].calls++;
+    }
+
+    void compare() {
+        counts[current].comparisons++;
+    }
+
+    void visit() {
+        counts[current].visits++;
+    }
+
+    void rotate(RotationCase rotation) {
+        counts[current].rotations[rotation]++;
+    }
+
+    void split() {
+        counts[current].splits++;
+    }
+
+    void merge() {
+        counts[current].merges++;
+    }
+
+    void allocate() {
+        counts[current].allocations++;
+    }
+
+    void release() {
+        counts[current].frees++;
+    }
+};
+
+// Counters of the trees in the analysis in main: build with -DTREE_STATS to get
+// them, otherwise they cost nothing
+#ifdef TREE_STATS
+using AnalysisStats = OperationStats;
+#else
+using AnalysisStats = NoStats;
+#endif
+
+// Leaf depths counted as getAllDepths counts them (the root at depth 0), gathered
+// in one pass into a fixed histogram rather than a vector of every depth
+struct DepthStats {
+    static const int HISTOGRAM_SIZE = 128; // deeper leaves go into the last bucket
+
+    int maxDepth = 0;
+    unsigned long long leaves = 0;
+    unsigned long long depthSum = 0;
+    unsigned long long histogram[HISTOGRAM_SIZE] = {};
+
+    void addLeaf(int depth) {
+        maxDepth = std::max(maxDepth, depth);
+        leaves++;
+        depthSum += depth;
+        histogram[std::min(depth, HISTOGRAM_SIZE - 1)]++;
+    }
+
+    double mean() const {
+        return leaves ? double(depthSum) / leaves : 0;
+    }
+};
+
 // AVL Tree implementation
-template<typename T>
+template<typename T, typename Stats = NoStats>
 class AVLTree {
 private:
     AVLNode<T>* root;
+    Stats stats;
+
+    bool less(const T& a, const T& b) {
+        stats.compare();
+        return a < b;
+    }
+
+    bool equal(const T& a, const T& b) {
+        stats.compare();
+        return a == b;
+    }
     
     int height(AVLNode<T>* node) {
         return node ? node->height : 0;
@@ -67,11 +195,15 @@ private:
     }
     
     AVLNode<T>* insert(AVLNode<T>* node, T value) {
-        if (!node) return new AVLNode<T>(value);
+        if (!node) {
+            stats.allocate();
+            return new AVLNode<T>(value);
+        }
+        stats.visit();
         
-        if (value < node->data)
+        if (less(value, node->data))
             node->left = insert(node->left, value);
-        else if (value > node->data)
+        else if (less(node->data, value))
             node->right = insert(node->right, value);
         else
             return node;
@@ -81,21 +213,27 @@ private:
         int balance = balanceFactor(node);
         
         // Left Left Case
-        if (balance < -1 && value < node->left->data)
+        if (balance < -1 && less(value, node->left->data)) {
+            stats.rotate(ROTATE_LL);
             return rotateRight(node);
+        }
             
         // Right Right Case    
-        if (balance > 1 && value > node->right->data)
+        if (balance > 1 && less(node->right->data, value)) {
+            stats.rotate(ROTATE_RR);
             return rotateLeft(node);
+        }
             
         // Left Right Case
-        if (balance < -1 && value > node->left->data) {
+        if (balance < -1 && less(node->left->data, value)) {
+            stats.rotate(ROTATE_LR);
             node->left = rotateLeft(node->left);
             return rotateRight(node);
         }
         
         // Right Left Case
-        if (balance > 1 && value < node->right->data) {
+        if (balance > 1 && less(value, node->right->data)) {
+            stats.rotate(ROTATE_RL);
             node->right = rotateRight(node->right);
             return rotateLeft(node);
         }
@@ -105,10 +243,11 @@ private:
 
     AVLNode<T>* remove(AVLNode<T>* node, T value) {
         if (!node) return nullptr;
+        stats.visit();
 
-        if (value < node->data)
+        if (less(value, node->data))
             node->left = remove(node->left, value);
-        else if (value > node->data)
+        else if (less(node->data, value))
             node->right = remove(node->right, value);
         else {
             if (!node->left || !node->right) {
@@ -118,6 +257,7 @@ private:
                     node = nullptr;
                 } else
                     *node = *temp;
+                stats.release();
                 delete temp;
             } else {
                 AVLNode<T>* temp = findMin(node->right);
@@ -132,21 +272,27 @@ private:
         int balance = balanceFactor(node);
 
         // Left Left Case
-        if (balance < -1 && balanceFactor(node->left) <= 0)
+        if (balance < -1 && balanceFactor(node->left) <= 0) {
+            stats.rotate(ROTATE_LL);
             return rotateRight(node);
+        }
 
         // Left Right Case
         if (balance < -1 && balanceFactor(node->left) > 0) {
+            stats.rotate(ROTATE_LR);
             node->left = rotateLeft(node->left);
             return rotateRight(node);
         }
 
         // Right Right Case
-        if (balance > 1 && balanceFactor(node->right) >= 0)
+        if (balance > 1 && balanceFactor(node->right) >= 0) {
+            stats.rotate(ROTATE_RR);
             return rotateLeft(node);
+        }
 
         // Right Left Case
         if (balance > 1 && balanceFactor(node->right) < 0) {
+            stats.rotate(ROTATE_RL);
             node->right = rotateRight(node->right);
             return rotateLeft(node);
         }
@@ -155,12 +301,29 @@ private:
     }
 
     AVLNode<T>* search(AVLNode<T>* node, T value) {
-        if (!node || node->data == value) return node;
-        if (value < node->data)
+        if (!node) return node;
+        stats.visit();
+        if (equal(node->data, value)) return node;
+        if (less(value, node->data))
             return search(node->left, value);
         return search(node->right, value);
     }
 
+    // In-order walk over the keys from value up, until limit of them are seen
+    void scan(AVLNode<T>* node, T value, int limit, int& seen) {
+        if (!node || seen >= limit) return;
+        stats.visit();
+        if (less(node->data, value)) {
+            scan(node->right, value, limit, seen);
+            return;
+        }
+        scan(node->left, value, limit, seen);
+        if (seen < limit) {
+            seen++;
+            scan(node->right, value, limit, seen);
+        }
+    }
+
     AVLNode<T>* findMin(AVLNode<T>* node) {
         while (node->left) node = node->left;
         return node;
@@ -181,21 +344,43 @@ private:
         getAllDepths(node->right, currentDepth + 1, depths);
     }
 
+    void collectDepths(AVLNode<T>* node, int currentDepth, DepthStats& depths) {
+        if (!node) return;
+        if (!node->left && !node->right) {
+            depths.addLeaf(currentDepth);
+            return;
+        }
+        collectDepths(node->left, currentDepth + 1, depths);
+        collectDepths(node->right, currentDepth + 1, depths);
+    }
+
 public:
     AVLTree() : root(nullptr) {}
     
     void insert(T value) {
+        stats.begin(OP_INSERT);
         root = insert(root, value);
     }
 
     void remove(T value) {
+        stats.begin(OP_REMOVE);
         root = remove(root, value);
     }
 
     bool search(T value) {
+        stats.begin(OP_SEARCH);
         return search(root, value) != nullptr;
     }
 
+    // Number of keys, at most limit, seen walking in order from the first key
+    // not less than value
+    int scan(T value, int limit) {
+        stats.begin(OP_SCAN);
+        int seen = 0;
+        scan(root, value, limit, seen);
+        return seen;
+    }
+
     int getMaxDepth() {
         return getMaxDepth(root);
     }
@@ -205,19 +390,59 @@ public:
         getAllDepths(root, 0, depths);
         return depths;
     }
+
+    DepthStats getDepthStats() {
+        DepthStats depths;
+        collectDepths(root, 0, depths);
+        return depths;
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+    void resetStats() {
+        stats = Stats();
+    }
 };
 
 // Treap (Cartesian Tree) implementation
-template<typename T>
+template<typename T, typename Stats = NoStats>
 class Treap {
 private:
+    // Estimated subtree size from which set operations hand one half to another thread
+    static const int PARALLEL_CUTOFF = 1 << 15;
+
+    Stats stats; // first, so it is ready when the copy constructor counts allocations
     TreapNode<T>* root;
     std::mt19937 rng;
+
+    bool less(const T& a, const T& b) {
+        stats.compare();
+        return a < b;
+    }
+
+    bool equal(const T& a, const T& b) {
+        stats.compare();
+        return a == b;
+    }
+
+    TreapNode<T>* newNode(T value, int priority) {
+        stats.allocate();
+        return new TreapNode<T>(value, priority);
+    }
+
+    void freeNode(TreapNode<T>* node) {
+        if (!node) return;
+        stats.release();
+        delete node;
+    }
     
     std::pair<TreapNode<T>*, TreapNode<T>*> split(TreapNode<T>* root, T value) {
+        stats.split();
         if (!root) return {nullptr, nullptr};
         
-        if (root->data <= value) {
+        if (!less(value, root->data)) {
             auto [left, right] = split(root->right, value);
             root->right = left;
             return {root, right};
@@ -229,6 +454,7 @@ private:
     }
     
     TreapNode<T>* merge(TreapNode<T>* left, TreapNode<T>* right) {
+        stats.merge();
         if (!left || !right) return left ? left : right;
         
         if (left->priority > right->priority) {
@@ -240,33 +466,54 @@ private:
         }
     }
     
-    TreapNode<T>* insert(TreapNode<T>* root, T value) {
+    TreapNode<T>* insert(TreapNode<T>* root, T value, std::mt19937& rng) {
         int priority = std::uniform_int_distribution<>()(rng);
         auto [left, right] = split(root, value);
-        TreapNode<T>* new_node = new TreapNode<T>(value, priority);
+        TreapNode<T>* new_node = newNode(value, priority);
         return merge(merge(left, new_node), right);
     }
 
     TreapNode<T>* remove(TreapNode<T>* root, T value) {
         if (!root) return nullptr;
+        stats.visit();
         
-        if (value < root->data)
+        if (less(value, root->data))
             root->left = remove(root->left, value);
-        else if (value > root->data)
+        else if (less(root->data, value))
             root->right = remove(root->right, value);
-        else
-            return merge(root->left, root->right);
+        else {
+            TreapNode<T>* merged = merge(root->left, root->right);
+            freeNode(root);
+            return merged;
+        }
         
         return root;
     }
 
     TreapNode<T>* search(TreapNode<T>* node, T value) {
-        if (!node || node->data == value) return node;
-        if (value < node->data)
+        if (!node) return node;
+        stats.visit();
+        if (equal(node->data, value)) return node;
+        if (less(value, node->data))
             return search(node->left, value);
         return search(node->right, value);
     }
 
+    // In-order walk over the keys from value up, until limit of them are seen
+    void scan(TreapNode<T>* node, T value, int limit, int& seen) {
+        if (!node || seen >= limit) return;
+        stats.visit();
+        if (less(node->data, value)) {
+            scan(node->right, value, limit, seen);
+            return;
+        }
+        scan(node->left, value, limit, seen);
+        if (seen < limit) {
+            seen++;
+            scan(node->right, value, limit, seen);
+        }
+    }
+
     int getMaxDepth(TreapNode<T>* node) {
         if (!node) return 0;
         return 1 + std::max(getMaxDepth(node->left), getMaxDepth(node->right));
@@ -282,24 +529,215 @@ private:
         getAllDepths(node->right, currentDepth + 1, depths);
     }
 
+    void collectDepths(TreapNode<T>* node, int currentDepth, DepthStats& depths) {
+        if (!node) return;
+        if (!node->left && !node->right) {
+            depths.addLeaf(currentDepth);
+            return;
+        }
+        collectDepths(node->left, currentDepth + 1, depths);
+        collectDepths(node->right, currentDepth + 1, depths);
+    }
+
+    // Split into the keys below value, the node holding value (or nullptr) and the keys above it
+    std::tuple<TreapNode<T>*, TreapNode<T>*, TreapNode<T>*> splitExact(TreapNode<T>* root, T value) {
+        stats.split();
+        if (!root) return {nullptr, nullptr, nullptr};
+
+        if (less(root->data, value)) {
+            auto [left, equal, right] = splitExact(root->right, value);
+            root->right = left;
+            return {root, equal, right};
+        } else if (less(value, root->data)) {
+            auto [left, equal, right] = splitExact(root->left, value);
+            root->left = right;
+            return {left, equal, root};
+        } else {
+            TreapNode<T>* left = root->left;
+            TreapNode<T>* right = root->right;
+            root->left = root->right = nullptr;
+            return {left, root, right};
+        }
+    }
+
+    void destroy(TreapNode<T>* node) {
+        if (!node) return;
+        destroy(node->left);
+        destroy(node->right);
+        freeNode(node);
+    }
+
+    TreapNode<T>* copy(TreapNode<T>* node) {
+        if (!node) return nullptr;
+        TreapNode<T>* result = newNode(node->data, node->priority);
+        result->left = copy(node->left);
+        result->right = copy(node->right);
+        return result;
+    }
+
+    // Priorities are uniform on [0, INT_MAX] and a node's is the largest in its
+    // subtree, so a subtree of n nodes has a root about INT_MAX / (n + 1) below the top
+    static bool isLarge(TreapNode<T>* node) {
+        return node && INT_MAX - node->priority < INT_MAX / PARALLEL_CUTOFF;
+    }
+
+    // Levels of recursion that may fork to keep threads busy; none while counting
+    static int forkLevels(unsigned threads) {
+        if (Stats::ENABLED) return 0;
+        int levels = 0;
+        while (threads > 1 && (1u << levels) < threads) levels++;
+        return threads > 1 ? levels + 1 : 0;
+    }
+
+    // Run both calls, the first on a new thread when fork is set
+    template<typename First, typename Second>
+    static void forkJoin(bool fork, First first, Second second) {
+        if (!fork) {
+            first();
+            second();
+            return;
+        }
+        std::thread worker(first);
+        second();
+        worker.join();
+    }
+
+    // Cartesian tree of the sorted range in O(n). The right spine of the tree built
+    // so far is kept on a stack; each key, the largest yet, hangs below the last
+    // spine node with a higher priority and takes the nodes it displaces from the
+    // spine as its left subtree.
+    template<typename It>
+    TreapNode<T>* buildSorted(It first, It last, std::mt19937& rng) {
+        std::vector<TreapNode<T>*> spine;
+        for (; first != last; ++first) {
+            TreapNode<T>* node = newNode(*first, std::uniform_int_distribution<>()(rng));
+            TreapNode<T>* displaced = nullptr;
+            while (!spine.empty() && spine.back()->priority < node->priority) {
+                displaced = spine.back();
+                spine.pop_back();
+            }
+            node->left = displaced;
+            if (!spine.empty()) spine.back()->right = node;
+            spine.push_back(node);
+        }
+        return spine.empty() ? nullptr : spine.front();
+    }
+
+    // Set operations after Blelloch and Reid-Miller, "Fast Set Operations Using
+    // Treaps". The root with the higher priority stays on top, the other treap is
+    // split by its key and both halves recurse independently, which takes
+    // O(m log(n/m + 1)) expected time for sizes m <= n. Both treaps are consumed.
+    TreapNode<T>* unite(TreapNode<T>* a, TreapNode<T>* b, int forks) {
+        if (!a) return b;
+        if (!b) return a;
+        if (a->priority < b->priority) std::swap(a, b);
+
+        auto [left, equal, right] = splitExact(b, a->data);
+        freeNode(equal);
+        forkJoin(forks > 0 && isLarge(a),
+                 [&]() { a->left = unite(a->left, left, forks - 1); },
+                 [&]() { a->right = unite(a->right, right, forks - 1); });
+        return a;
+    }
+
+    TreapNode<T>* intersect(TreapNode<T>* a, TreapNode<T>* b, int forks) {
+        if (!a || !b) {
+            destroy(a);
+            destroy(b);
+            return nullptr;
+        }
+        if (a->priority < b->priority) std::swap(a, b);
+
+        auto [left, equal, right] = splitExact(b, a->data);
+        TreapNode<T>* lower;
+        TreapNode<T>* upper;
+        forkJoin(forks > 0 && isLarge(a),
+                 [&]() { lower = intersect(a->left, left, forks - 1); },
+                 [&]() { upper = intersect(a->right, right, forks - 1); });
+        if (equal) {
+            freeNode(equal);
+            a->left = lower;
+            a->right = upper;
+            return a;
+        }
+        freeNode(a);
+        return merge(lower, upper);
+    }
+
+    // Keys of a not in b; not symmetric, so whichever root is higher is split around
+    TreapNode<T>* difference(TreapNode<T>* a, TreapNode<T>* b, int forks) {
+        if (!a || !b) {
+            destroy(b);
+            return a;
+        }
+
+        TreapNode<T>* lower;
+        TreapNode<T>* upper;
+        if (a->priority > b->priority) {
+            auto [left, equal, right] = splitExact(b, a->data);
+            forkJoin(forks > 0 && isLarge(a),
+                     [&]() { lower = difference(a->left, left, forks - 1); },
+                     [&]() { upper = difference(a->right, right, forks - 1); });
+            if (equal) {
+                freeNode(equal);
+                freeNode(a);
+                return merge(lower, upper);
+            }
+            a->left = lower;
+            a->right = upper;
+            return a;
+        }
+
+        auto [left, equal, right] = splitExact(a, b->data);
+        forkJoin(forks > 0 && isLarge(b),
+                 [&]() { lower = difference(left, b->left, forks - 1); },
+                 [&]() { upper = difference(right, b->right, forks - 1); });
+        freeNode(equal);
+        freeNode(b);
+        return merge(lower, upper);
+    }
+
 public:
     Treap() : root(nullptr) {
         std::random_device rd;
         rng.seed(rd());
     }
+
+    Treap(const Treap& other) : root(nullptr), rng(other.rng) {
+        stats.begin(OP_BUILD);
+        root = copy(other.root);
+    }
+
+    Treap& operator=(const Treap&) = delete;
+
+    ~Treap() {
+        destroy(root);
+    }
     
     void insert(T value) {
-        root = insert(root, value);
+        stats.begin(OP_INSERT);
+        root = insert(root, value, rng);
     }
 
     void remove(T value) {
+        stats.begin(OP_REMOVE);
         root = remove(root, value);
     }
 
     bool search(T value) {
+        stats.begin(OP_SEARCH);
         return search(root, value) != nullptr;
     }
 
+    // Number of keys, at most limit, seen walking in order from the first key
+    // not less than value
+    int scan(T value, int limit) {
+        stats.begin(OP_SCAN);
+        int seen = 0;
+        scan(root, value, limit, seen);
+        return seen;
+    }
+
     int getMaxDepth() {
         return getMaxDepth(root);
     }
@@ -309,8 +747,1329 @@ public:
         getAllDepths(root, 0, depths);
         return depths;
     }
+
+    // Replace the contents with the keys of the sorted range [first, last) in O(n).
+    // Priorities come from the same distribution as in insert, so the tree is shaped
+    // like one filled key by key. Duplicates are kept, as insert keeps them.
+    template<typename It>
+    void buildFromSorted(It first, It last) {
+        stats.begin(OP_BUILD);
+        destroy(root);
+        root = buildSorted(first, last, rng);
+    }
+
+    // The same for a range in any order, which is sorted first
+    template<typename It>
+    void buildFrom(It first, It last) {
+        std::vector<T> values(first, last);
+        std::sort(values.begin(), values.end());
+        buildFromSorted(values.begin(), values.end());
+    }
+
+    // Set operations with other, which is left empty. Both treaps are taken as
+    // sets. Recursion forks while subtrees are large and threads are left.
+    void unionWith(Treap& other, unsigned threads = std::thread::hardware_concurrency()) {
+        stats.begin(OP_SET);
+        root = unite(root, other.root, forkLevels(threads));
+        other.root = nullptr;
+    }
+
+    void intersectWith(Treap& other, unsigned threads = std::thread::hardware_concurrency()) {
+        stats.begin(OP_SET);
+        root = intersect(root, other.root, forkLevels(threads));
+        other.root = nullptr;
+    }
+
+    void differenceWith(Treap& other, unsigned threads = std::thread::hardware_concurrency()) {
+        stats.begin(OP_SET);
+        root = difference(root, other.root, forkLevels(threads));
+        other.root = nullptr;
+    }
+
+    // Add the keys of values that are not present yet. Each thread sorts its share
+    // of the batch and builds a treap from it, and the pieces are united into this one.
+    void bulkInsert(const std::vector<T>& values, unsigned threads = std::thread::hardware_concurrency()) {
+        stats.begin(OP_BUILD);
+        if (Stats::ENABLED) threads = 1;
+        size_t chunks = std::max(1u, std::min<unsigned>(threads, values.size() / PARALLEL_CUTOFF + 1));
+        std::vector<TreapNode<T>*> pieces(chunks, nullptr);
+        std::vector<unsigned> seeds(chunks);
+        for (unsigned& seed : seeds) seed = rng();
+
+        auto build = [&](size_t chunk) {
+            std::mt19937 chunkRng(seeds[chunk]);
+            std::vector<T> share(values.begin() + values.size() * chunk / chunks,
+                                 values.begin() + values.size() * (chunk + 1) / chunks);
+            std::sort(share.begin(), share.end());
+            share.erase(std::unique(share.begin(), share.end()), share.end());
+            pieces[chunk] = buildSorted(share.begin(), share.end(), chunkRng);
+        };
+        std::vector<std::thread> workers;
+        for (size_t chunk = 1; chunk < chunks; chunk++) workers.emplace_back(build, chunk);
+        build(0);
+        for (std::thread& worker : workers) worker.join();
+
+        int forks = forkLevels(threads);
+        for (size_t width = 1; width < chunks; width *= 2) {
+            std::vector<std::thread> mergers;
+            for (size_t chunk = 0; chunk + width < chunks; chunk += 2 * width) {
+                mergers.emplace_back([&, chunk, width]() {
+                    pieces[chunk] = unite(pieces[chunk], pieces[chunk + width], 0);
+                });
+            }
+            for (std::thread& merger : mergers) merger.join();
+        }
+        root = unite(root, pieces[0], forks);
+    }
+
+    DepthStats getDepthStats() {
+        DepthStats depths;
+        collectDepths(root, 0, depths);
+        return depths;
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+    void resetStats() {
+        stats = Stats();
+    }
+};
+
+// Node of PersistentTreap. Once it is reachable from a published version it is
+// never changed again; refs counts the parents and versions holding it.
+template<typename T>
+struct PersistentTreapNode {
+    T data;
+    int priority;
+    PersistentTreapNode* left;
+    PersistentTreapNode* right;
+    std::atomic<int> refs;
+    PersistentTreapNode(T value, int p, PersistentTreapNode* l = nullptr, PersistentTreapNode* r = nullptr)
+        : data(value), priority(p), left(l), right(r), refs(1) {}
 };
 
+// Persistent treap: split and merge copy the nodes on the path they change and
+// share the rest with the previous version, so an update allocates O(log n) nodes
+// and every old version stays intact. snapshot() hands out a version in O(1);
+// nodes are reference counted and freed when the last version using them goes.
+// Updates are serialised; snapshots can be taken and read from any thread while
+// an update runs.
+template<typename T>
+class PersistentTreap {
+private:
+    using Node = PersistentTreapNode<T>;
+
+    static Node* retain(Node* node) {
+        if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+
+    static void release(Node* node) {
+        if (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            release(node->left);
+            release(node->right);
+            delete node;
+        }
+    }
+
+public:
+    // Read-only view of one version; holds a reference to its root
+    class Snapshot {
+    private:
+        Node* root;
+
+        explicit Snapshot(Node* root) : root(root) {}
+
+        static int getMaxDepth(Node* node) {
+            if (!node) return 0;
+            return 1 + std::max(getMaxDepth(node->left), getMaxDepth(node->right));
+        }
+
+        friend class PersistentTreap;
+
+    public:
+        Snapshot() : root(nullptr) {}
+        Snapshot(const Snapshot& other) : root(retain(other.root)) {}
+        Snapshot(Snapshot&& other) noexcept : root(other.root) { other.root = nullptr; }
+
+        Snapshot& operator=(Snapshot other) noexcept {
+            std::swap(root, other.root);
+            return *this;
+        }
+
+        ~Snapshot() {
+            release(root);
+        }
+
+        bool search(T value) const {
+            Node* node = root;
+            while (node && node->data != value) {
+                node = value < node->data ? node->left : node->right;
+            }
+            return node != nullptr;
+        }
+
+        int getMaxDepth() const {
+            return getMaxDepth(root);
+        }
+    };
+
+private:
+    Node* root;
+    std::mt19937 rng;
+    std::mutex writeLock; // one update at a time
+    mutable std::mutex rootLock; // guards reading and replacing root
+
+    // A node the caller may change: node itself when the caller holds its only
+    // reference (then nothing published can reach it), otherwise a copy sharing
+    // its children. Takes over the caller's reference either way.
+    static Node* unshare(Node* node) {
+        if (node->refs.load(std::memory_order_acquire) == 1) return node;
+        Node* copy = new Node(node->data, node->priority, retain(node->left), retain(node->right));
+        release(node);
+        return copy;
+    }
+
+    // split, merge, insert and remove take over the references they are given and
+    // return owned ones
+    static std::pair<Node*, Node*> split(Node* root, T value) {
+        if (!root) return {nullptr, nullptr};
+
+        root = unshare(root);
+        if (root->data <= value) {
+            auto [left, right] = split(root->right, value);
+            root->right = left;
+            return {root, right};
+        } else {
+            auto [left, right] = split(root->left, value);
+            root->left = right;
+            return {left, root};
+        }
+    }
+
+    static Node* merge(Node* left, Node* right) {
+        if (!left || !right) return left ? left : right;
+
+        if (left->priority > right->priority) {
+            left = unshare(left);
+            left->right = merge(left->right, right);
+            return left;
+        } else {
+            right = unshare(right);
+            right->left = merge(left, right->left);
+            return right;
+        }
+    }
+
+    static Node* remove(Node* root, T value) {
+        if (!root) return nullptr;
+
+        root = unshare(root);
+        if (value < root->data) {
+            root->left = remove(root->left, value);
+        } else if (value > root->data) {
+            root->right = remove(root->right, value);
+        } else {
+            Node* merged = merge(root->left, root->right);
+            root->left = root->right = nullptr;
+            release(root);
+            return merged;
+        }
+        return root;
+    }
+
+    // Current version with a reference for the caller
+    Node* acquireRoot() const {
+        std::lock_guard<std::mutex> lock(rootLock);
+        return retain(root);
+    }
+
+    void publish(Node* updated) {
+        Node* old;
+        {
+            std::lock_guard<std::mutex> lock(rootLock);
+            old = root;
+            root = updated;
+        }
+        release(old);
+    }
+
+public:
+    PersistentTreap() : root(nullptr) {
+        std::random_device rd;
+        rng.seed(rd());
+    }
+
+    ~PersistentTreap() {
+        release(root);
+    }
+
+    PersistentTreap(const PersistentTreap&) = delete;
+    PersistentTreap& operator=(const PersistentTreap&) = delete;
+
+    // The current version; stays unchanged while the tree moves on
+    Snapshot snapshot() const {
+        return Snapshot(acquireRoot());
+    }
+
+    void insert(T value) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        int priority = std::uniform_int_distribution<>()(rng);
+        auto [left, right] = split(acquireRoot(), value);
+        publish(merge(merge(left, new Node(value, priority)), right));
+    }
+
+    void remove(T value) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        Snapshot current = snapshot();
+        if (!current.search(value)) return; // leave the version as it is
+        publish(remove(acquireRoot(), value));
+    }
+
+    bool search(T value) const {
+        return snapshot().search(value);
+    }
+
+    int getMaxDepth() const {
+        return snapshot().getMaxDepth();
+    }
+};
+
+// Epoch-based reclamation for the lock-free skip list. Every operation runs
+// inside a Guard, which publishes the global epoch the operation started in.
+// Unlinked nodes are retired with the epoch current at that time and deleted once
+// the global epoch is two steps further; the epoch only advances when every active
+// thread has caught up with it, so by then no operation can still hold them.
+class EpochReclaimer {
+private:
+    static const int MAX_THREADS = 256;
+    static const uint64_t IDLE = UINT64_MAX;
+    // Retirements between two attempts to advance the epoch and free nodes
+    static const size_t COLLECT_BATCH = 128;
+
+    struct Retired {
+        void* object;
+        void (*destroy)(void*);
+        uint64_t epoch;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{IDLE};
+        std::atomic<bool> claimed{false};
+        std::vector<Retired> limbo; // only touched by the thread owning the slot
+        size_t collectAt = COLLECT_BATCH;
+    };
+
+    // A thread claims a slot on first use and gives it back when it exits; the
+    // limbo list stays with the slot for its next owner
+    struct ThreadSlot {
+        Slot* slot = nullptr;
+
+        ThreadSlot() {
+            for (Slot& candidate : instance().slots) {
+                bool expected = false;
+                if (candidate.claimed.compare_exchange_strong(expected, true)) {
+                    slot = &candidate;
+                    return;
+                }
+            }
+            throw std::runtime_error("EpochReclaimer: too many threads");
+        }
+
+        ~ThreadSlot() {
+            slot->claimed.store(false, std::memory_order_release);
+        }
+    };
+
+    std::atomic<uint64_t> globalEpoch{0};
+    Slot slots[MAX_THREADS];
+
+    EpochReclaimer() = default;
+
+    static Slot& currentSlot() {
+        thread_local ThreadSlot threadSlot;
+        return *threadSlot.slot;
+    }
+
+    void collect(Slot& slot) {
+        uint64_t epoch = globalEpoch.load();
+        bool caughtUp = true;
+        for (Slot& other : slots) {
+            uint64_t seen = other.epoch.load();
+            if (seen != IDLE && seen != epoch) {
+                caughtUp = false;
+                break;
+            }
+        }
+        if (caughtUp) globalEpoch.compare_exchange_strong(epoch, epoch + 1);
+
+        uint64_t safe = globalEpoch.load();
+        auto pending = std::partition(slot.limbo.begin(), slot.limbo.end(),
+                                      [safe](const Retired& r) { return r.epoch + 2 > safe; });
+        for (auto it = pending; it != slot.limbo.end(); ++it) it->destroy(it->object);
+        slot.limbo.erase(pending, slot.limbo.end());
+        slot.collectAt = slot.limbo.size() + COLLECT_BATCH;
+    }
+
+public:
+    static EpochReclaimer& instance() {
+        static EpochReclaimer reclaimer;
+        return reclaimer;
+    }
+
+    // Runs after all other threads have finished
+    ~EpochReclaimer() {
+        for (Slot& slot : slots) {
+            for (Retired& r : slot.limbo) r.destroy(r.object);
+        }
+    }
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    class Guard {
+    private:
+        Slot& slot;
+
+    public:
+        Guard() : slot(currentSlot()) {
+            slot.epoch.store(instance().globalEpoch.load());
+        }
+
+        ~Guard() {
+            slot.epoch.store(IDLE, std::memory_order_release);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    // Delete object once no running operation can reach it; call inside a Guard
+    // after object has been unlinked
+    template<typename Object>
+    void retire(Object* object) {
+        retire(object, [](void* p) { delete static_cast<Object*>(p); });
+    }
+
+    // Same for objects that destroy() has to free, such as nodes allocated with
+    // their links in one block
+    void retire(void* object, void (*destroy)(void*)) {
+        Slot& slot = currentSlot();
+        slot.limbo.push_back({object, destroy, globalEpoch.load()});
+        if (slot.limbo.size() >= slot.collectAt) collect(slot);
+    }
+};
+
+// Node of LockFreeSkipList; its height forward links follow it in the same
+// allocation. The low bit of a link marks the node as removed on that level.
+template<typename T>
+struct alignas(std::atomic<uintptr_t>) SkipListNode {
+    using Link = std::atomic<uintptr_t>;
+
+    T data;
+    int height;
+    // Set by whichever of the inserting thread (done linking the upper levels)
+    // and the removing thread (done marking) gets there first; the other one
+    // unlinks the node for good and retires it
+    std::atomic<int> state;
+
+    SkipListNode(const T& value, int h) : data(value), height(h), state(0) {}
+
+    Link& next(int level) {
+        return reinterpret_cast<Link*>(this + 1)[level];
+    }
+
+    static SkipListNode* create(const T& value, int height) {
+        void* memory = ::operator new(sizeof(SkipListNode) + height * sizeof(Link));
+        SkipListNode* node = new (memory) SkipListNode(value, height);
+        for (int level = 0; level < height; level++) new (&node->next(level)) Link(0);
+        return node;
+    }
+
+    static void destroy(void* memory) {
+        static_cast<SkipListNode*>(memory)->~SkipListNode();
+        ::operator delete(memory);
+    }
+};
+
+// Lock-free skip list (Fraser; Herlihy and Shavit) usable as a set by any number
+// of threads at once. remove() marks the links of a node, top level first; the
+// bottom mark decides which remove wins and takes the key out of the set. Any
+// traversal that meets a marked node unlinks it, search() only skips it. Nodes
+// are freed through the EpochReclaimer once they are unlinked on every level.
+template<typename T>
+class LockFreeSkipList {
+private:
+    using Node = SkipListNode<T>;
+    static const int MAX_LEVEL = 32;
+    static const uintptr_t MARK = 1;
+    enum { LINKING, LINKED, REMOVED };
+
+    Node* head;
+    std::atomic<int> levels{1}; // no node is higher than this
+
+    static Node* pointer(uintptr_t link) {
+        return reinterpret_cast<Node*>(link & ~MARK);
+    }
+
+    static bool marked(uintptr_t link) {
+        return link & MARK;
+    }
+
+    static uintptr_t address(Node* node) {
+        return reinterpret_cast<uintptr_t>(node);
+    }
+
+    // Height h with probability 2^-h
+    static int randomHeight() {
+        thread_local std::mt19937 rng(std::random_device{}());
+        uint32_t bits = rng();
+        int height = 1;
+        while ((bits & 1) && height < MAX_LEVEL) {
+            bits >>= 1;
+            height++;
+        }
+        return height;
+    }
+
+    // Last node before value and first node from value on, on every level,
+    // unlinking the marked nodes met on the way. True if value is in the set.
+    bool find(const T& value, Node** preds, Node** succs) {
+        bool restart;
+        do {
+            restart = false;
+            Node* pred = head;
+            for (int level = levels.load() - 1; level >= 0 && !restart; level--) {
+                Node* curr = pointer(pred->next(level).load(std::memory_order_acquire));
+                while (curr) {
+                    uintptr_t succ = curr->next(level).load(std::memory_order_acquire);
+                    if (marked(succ)) {
+                        uintptr_t expected = address(curr);
+                        if (!pred->next(level).compare_exchange_strong(expected, succ & ~MARK)) {
+                            restart = true; // pred changed or was marked itself
+                            break;
+                        }
+                        curr = pointer(succ);
+                        continue;
+                    }
+                    if (!(curr->data < value)) break;
+                    pred = curr;
+                    curr = pointer(succ);
+                }
+                preds[level] = pred;
+                succs[level] = curr;
+            }
+        } while (restart);
+        return succs[0] && !(value < succs[0]->data);
+    }
+
+    // Link node above the bottom level, which it is already in. Stops early if
+    // the node gets removed meanwhile.
+    void linkUpperLevels(Node* node, Node** preds, Node** succs) {
+        for (int level = 1; level < node->height; level++) {
+            while (true) {
+                uintptr_t link = node->next(level).load();
+                if (marked(link)) return;
+                if (pointer(link) != succs[level] &&
+                    !node->next(level).compare_exchange_strong(link, address(succs[level]))) {
+                    return; // only a mark can have changed it
+                }
+                uintptr_t expected = address(succs[level]);
+                if (preds[level]->next(level).compare_exchange_strong(expected, address(node))) break;
+                find(node->data, preds, succs);
+                if (succs[0] != node) return;
+            }
+        }
+    }
+
+    // Unlink every marked node equal to value from every level. Unlike find it
+    // goes on past unmarked equal nodes: a node inserted again with the same
+    // value can sit in front of a removed one on an upper level.
+    void unlinkMarked(const T& value) {
+        bool restart;
+        do {
+            restart = false;
+            Node* before = head; // last node before value, where the next level starts
+            for (int level = levels.load() - 1; level >= 0 && !restart; level--) {
+                Node* pred = before;
+                Node* curr = pointer(pred->next(level).load(std::memory_order_acquire));
+                while (curr && !(value < curr->data)) {
+                    uintptr_t succ = curr->next(level).load(std::memory_order_acquire);
+                    if (marked(succ)) {
+                        uintptr_t expected = address(curr);
+                        if (!pred->next(level).compare_exchange_strong(expected, succ & ~MARK)) {
+                            restart = true;
+                            break;
+                        }
+                        curr = pointer(succ);
+                        continue;
+                    }
+                    if (curr->data < value) before = curr;
+                    pred = curr;
+                    curr = pointer(succ);
+                }
+            }
+        } while (restart);
+    }
+
+    // Called by the second of the inserting and removing threads to finish with
+    // the node, which is linked on no more levels once unlinkMarked returns
+    void unlinkAndRetire(Node* node) {
+        unlinkMarked(node->data);
+        EpochReclaimer::instance().retire(node, Node::destroy);
+    }
+
+public:
+    LockFreeSkipList() : head(Node::create(T(), MAX_LEVEL)) {}
+
+    LockFreeSkipList(const LockFreeSkipList&) = delete;
+    LockFreeSkipList& operator=(const LockFreeSkipList&) = delete;
+
+    // No other thread may use the list any more
+    ~LockFreeSkipList() {
+        Node* node = head;
+        while (node) {
+            Node* next = pointer(node->next(0).load());
+            Node::destroy(node);
+            node = next;
+        }
+    }
+
+    void insert(T value) {
+        EpochReclaimer::Guard guard;
+        Node* preds[MAX_LEVEL];
+        Node* succs[MAX_LEVEL];
+        int height = randomHeight();
+        int top = levels.load();
+        while (top < height && !levels.compare_exchange_weak(top, height)) {}
+
+        Node* node = nullptr;
+        while (true) {
+            if (find(value, preds, succs)) {
+                if (node) Node::destroy(node); // never published
+                return;
+            }
+            if (!node) node = Node::create(value, height);
+            for (int level = 0; level < height; level++) {
+                node->next(level).store(address(succs[level]), std::memory_order_relaxed);
+            }
+            uintptr_t expected = address(succs[0]);
+            if (preds[0]->next(0).compare_exchange_strong(expected, address(node))) break;
+        }
+
+        linkUpperLevels(node, preds, succs);
+        if (node->state.exchange(LINKED) == REMOVED) unlinkAndRetire(node);
+    }
+
+    void remove(T value) {
+        EpochReclaimer::Guard guard;
+        Node* preds[MAX_LEVEL];
+        Node* succs[MAX_LEVEL];
+        if (!find(value, preds, succs)) return;
+
+        Node* victim = succs[0];
+        for (int level = victim->height - 1; level > 0; level--) {
+            uintptr_t link = victim->next(level).load();
+            while (!marked(link)) victim->next(level).compare_exchange_weak(link, link | MARK);
+        }
+        uintptr_t link = victim->next(0).load();
+        while (!marked(link)) {
+            if (victim->next(0).compare_exchange_weak(link, link | MARK)) {
+                if (victim->state.exchange(REMOVED) == LINKED) unlinkAndRetire(victim);
+                return;
+            }
+        }
+        // another remove marked it first
+    }
+
+    // Wait-free: steps over marked nodes instead of unlinking them
+    bool search(T value) {
+        EpochReclaimer::Guard guard;
+        Node* pred = head;
+        Node* curr = nullptr;
+        for (int level = levels.load() - 1; level >= 0; level--) {
+            curr = pointer(pred->next(level).load(std::memory_order_acquire));
+            while (curr) {
+                uintptr_t succ = curr->next(level).load(std::memory_order_acquire);
+                if (!marked(succ)) {
+                    if (!(curr->data < value)) break;
+                    pred = curr;
+                }
+                curr = pointer(succ);
+            }
+        }
+        return curr && !(value < curr->data);
+    }
+
+    // Node heights in one pass along the bottom level, a node of height h counted
+    // as a leaf at depth h. Exact only while no update runs.
+    DepthStats getLevelStats() {
+        DepthStats heights;
+        for (Node* node = pointer(head->next(0).load()); node; node = pointer(node->next(0).load())) {
+            if (!marked(node->next(0).load())) heights.addLeaf(node->height);
+        }
+        return heights;
+    }
+
+    int getMaxDepth() {
+        return getLevelStats().maxDepth;
+    }
+
+    // True if every level is strictly increasing, holds no marked node and only
+    // nodes of the level below. Exact only while no update runs.
+    bool isConsistent() {
+        for (int level = 0; level < MAX_LEVEL; level++) {
+            Node* below = head;
+            Node* prev = nullptr;
+            for (Node* node = pointer(head->next(level).load()); node; node = pointer(node->next(level).load())) {
+                if (marked(node->next(level).load()) || node->height <= level) return false;
+                if (prev && !(prev->data < node->data)) return false;
+                if (level) {
+                    while (below && below != node) below = pointer(below->next(level - 1).load());
+                    if (!below) return false;
+                }
+                prev = node;
+            }
+        }
+        return true;
+    }
+};
+
+// Resident set size of this process in KB
+long residentKb() {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Run measure() in a child process so every run starts from the same heap, and
+// return the count values it produced (zeros if the child failed)
+template<typename Measure>
+std::vector<double> measureInChild(size_t count, Measure measure) {
+    int fds[2];
+    if (pipe(fds) != 0) return std::vector<double>(count, 0);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        std::vector<double> result = measure();
+        result.resize(count);
+        ssize_t bytes = count * sizeof(double);
+        ssize_t written = write(fds[1], result.data(), bytes);
+        _exit(written == bytes ? 0 : 1);
+    }
+
+    close(fds[1]);
+    std::vector<double> result(count, 0);
+    ssize_t got = read(fds[0], result.data(), count * sizeof(double));
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+    if (got != ssize_t(count * sizeof(double))) return std::vector<double>(count, 0);
+    return result;
+}
+
+// Join-based set operations and bulk insert on treaps of 2^18 ... 2^24 keys, from
+// one thread up to all cores. B has a quarter as many keys as A, half of them in A.
+// Every operation runs in its own child process on copies of A and B, so earlier
+// runs do not leave it a fragmented heap.
+void benchmarkSetOperations(std::ofstream& outFile, std::mt19937& gen) {
+    outFile << "\nTreap set operations (|B| = N/4, half of B in A)\n";
+    outFile << "N\tThreads\tUnion (ms)\tIntersect (ms)\tDifference (ms)\tBulk insert (ms)\tInsert loop (ms)\n";
+
+    unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    auto elapsedMs = [](auto&& action) {
+        auto start = std::chrono::high_resolution_clock::now();
+        action();
+        auto end = std::chrono::high_resolution_clock::now();
+        return (double)std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    };
+
+    for (int i = 18; i <= 24; i += 2) {
+        int N = 1 << i;
+        std::vector<int> aValues(N);
+        for (int j = 0; j < N; j++) {
+            aValues[j] = 2 * j;
+        }
+        std::shuffle(aValues.begin(), aValues.end(), gen);
+        std::vector<int> bValues(N / 4);
+        for (int j = 0; j < N / 4; j++) {
+            bValues[j] = j % 2 ? aValues[j] : 2 * std::uniform_int_distribution<>(0, N - 1)(gen) + 1;
+        }
+
+        Treap<int> a, b;
+        a.bulkInsert(aValues);
+        b.bulkInsert(bValues);
+
+        for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+            auto timeOperation = [&](void (Treap<int>::*operation)(Treap<int>&, unsigned)) {
+                return measureInChild(1, [&]() {
+                    Treap<int> x(a), y(b);
+                    return std::vector<double>{elapsedMs([&]() { (x.*operation)(y, threads); })};
+                })[0];
+            };
+            double unionTime = timeOperation(&Treap<int>::unionWith);
+            double intersectTime = timeOperation(&Treap<int>::intersectWith);
+            double differenceTime = timeOperation(&Treap<int>::differenceWith);
+            double bulkTime = measureInChild(1, [&]() {
+                Treap<int> bulk(a);
+                return std::vector<double>{elapsedMs([&]() { bulk.bulkInsert(bValues, threads); })};
+            })[0];
+
+            outFile << N << "\t" << threads << "\t" << unionTime << "\t\t" << intersectTime << "\t\t"
+                    << differenceTime << "\t\t" << bulkTime << "\t\t";
+            if (threads == 1) {
+                outFile << measureInChild(1, [&]() {
+                    Treap<int> loop(a);
+                    return std::vector<double>{elapsedMs([&]() {
+                        for (int val : bValues) {
+                            if (!loop.search(val)) loop.insert(val);
+                        }
+                    })};
+                })[0];
+            } else {
+                outFile << "-";
+            }
+            outFile << "\n";
+        }
+    }
+}
+
+// Filling a treap key by key against the linear-time build from sorted keys and
+// the build that sorts first. Times and depths are averaged over REPEATS trees.
+void benchmarkSortedBuild(std::ofstream& outFile, std::mt19937& gen) {
+    const int REPEATS = 5;
+    outFile << "\nTreap construction (average of " << REPEATS << " trees)\n";
+    outFile << "N\tMethod\t\tFill (ms)\tMax depth\tAverage depth\n";
+
+    for (int i = 16; i <= 22; i += 2) {
+        int N = 1 << i;
+        std::vector<int> sorted(N);
+        for (int j = 0; j < N; j++) {
+            sorted[j] = j;
+        }
+        std::vector<int> shuffled = sorted;
+        std::shuffle(shuffled.begin(), shuffled.end(), gen);
+
+        auto run = [&](const char* method, auto fill) {
+            std::vector<double> r = measureInChild(3, [&]() {
+                double fillMs = 0, maxDepth = 0, avgDepth = 0;
+                for (int repeat = 0; repeat < REPEATS; repeat++) {
+                    Treap<int> treap;
+                    auto start = std::chrono::high_resolution_clock::now();
+                    fill(treap);
+                    auto end = std::chrono::high_resolution_clock::now();
+                    fillMs += std::chrono::duration<double, std::milli>(end - start).count();
+                    maxDepth += treap.getMaxDepth();
+                    avgDepth += treap.getDepthStats().mean();
+                }
+                return std::vector<double>{fillMs / REPEATS, maxDepth / REPEATS, avgDepth / REPEATS};
+            });
+            outFile << N << "\t" << method << "\t" << r[0] << "\t\t" << r[1] << "\t\t" << r[2] << "\n";
+        };
+        run("insert loop", [&](Treap<int>& treap) {
+            for (int value : shuffled) treap.insert(value);
+        });
+        run("sorted build", [&](Treap<int>& treap) { treap.buildFromSorted(sorted.begin(), sorted.end()); });
+        run("unsorted build", [&](Treap<int>& treap) { treap.buildFrom(shuffled.begin(), shuffled.end()); });
+    }
+}
+
+// Snapshots of a persistent treap: memory kept alive per retained version, and
+// readers that need a consistent view of many lookups while one thread updates.
+// The alternative for the mutable treap is to hold a shared lock for the whole
+// read, which keeps the writer out meanwhile.
+void benchmarkSnapshots(std::ofstream& outFile, std::mt19937& gen) {
+    const int N = 1 << 20;
+    const int VERSIONS = 1 << 12;
+    const int READ_BATCH = 1000; // lookups per consistent read
+    const auto DURATION = std::chrono::milliseconds(500);
+
+    std::vector<int> values(N);
+    for (int j = 0; j < N; j++) {
+        values[j] = 2 * j;
+    }
+    std::vector<int> shuffled = values;
+    std::shuffle(shuffled.begin(), shuffled.end(), gen);
+
+    std::vector<double> memory = measureInChild(2, [&]() {
+        PersistentTreap<int> treap;
+        for (int value : shuffled) treap.insert(value);
+        std::vector<PersistentTreap<int>::Snapshot> versions;
+        versions.reserve(VERSIONS);
+        long before = residentKb();
+        for (int v = 0; v < VERSIONS; v++) {
+            treap.insert(2 * v + 1);
+            versions.push_back(treap.snapshot());
+        }
+        long after = residentKb();
+        return std::vector<double>{double(after - before) * 1024 / VERSIONS, (double)treap.getMaxDepth()};
+    });
+    outFile << "\nPersistent treap snapshots (N = " << N << ")\n";
+    outFile << "Bytes per retained version: " << memory[0] << " (max depth " << memory[1] << ", "
+            << sizeof(PersistentTreapNode<int>) << "-byte nodes); a full copy is "
+            << (long long)N * sizeof(TreapNode<int>) << " bytes\n";
+
+    unsigned maxReaders = std::max(4u, std::thread::hardware_concurrency());
+    outFile << "Readers\tPersistent reads (Mops/s)\tPersistent writes (Kops/s)\t"
+            << "Locked reads (Mops/s)\tLocked writes (Kops/s)\n";
+
+    // Readers look up random keys in batches of READ_BATCH, each batch against one
+    // consistent version; the writer inserts and removes odd keys
+    auto run = [&](unsigned readers, auto readBatch, auto update) {
+        std::atomic<bool> stop{false};
+        std::atomic<long> reads{0}, writes{0};
+        std::vector<std::thread> threads;
+        for (unsigned r = 0; r < readers; r++) {
+            threads.emplace_back([&, r]() {
+                std::mt19937 local(r + 1);
+                std::uniform_int_distribution<> dis(0, 2 * N);
+                std::vector<int> keys(READ_BATCH);
+                long done = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (int& key : keys) key = dis(local);
+                    readBatch(keys);
+                    done += READ_BATCH;
+                }
+                reads += done;
+            });
+        }
+        threads.emplace_back([&]() {
+            std::mt19937 local(0);
+            std::uniform_int_distribution<> dis(0, N - 1);
+            long done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                update(2 * dis(local) + 1);
+                done += 2;
+            }
+            writes += done;
+        });
+        std::this_thread::sleep_for(DURATION);
+        stop = true;
+        for (std::thread& thread : threads) thread.join();
+        double seconds = std::chrono::duration<double>(DURATION).count();
+        return std::make_pair(reads / seconds / 1e6, writes / seconds / 1e3);
+    };
+
+    PersistentTreap<int> persistent;
+    for (int value : shuffled) persistent.insert(value);
+    Treap<int> locked;
+    locked.buildFromSorted(values.begin(), values.end());
+    std::shared_mutex lock;
+    std::atomic<long> hits{0};
+
+    for (unsigned readers = 1; readers <= maxReaders; readers *= 2) {
+        auto persistentRates = run(readers,
+            [&](const std::vector<int>& keys) {
+                PersistentTreap<int>::Snapshot version = persistent.snapshot();
+                long found = 0;
+                for (int key : keys) found += version.search(key);
+                hits += found;
+            },
+            [&](int key) {
+                persistent.insert(key);
+                persistent.remove(key);
+            });
+        auto lockedRates = run(readers,
+            [&](const std::vector<int>& keys) {
+                std::shared_lock<std::shared_mutex> guard(lock);
+                long found = 0;
+                for (int key : keys) found += locked.search(key);
+                hits += found;
+            },
+            [&](int key) {
+                {
+                    std::unique_lock<std::shared_mutex> guard(lock);
+                    locked.insert(key);
+                }
+                std::unique_lock<std::shared_mutex> guard(lock);
+                locked.remove(key);
+            });
+        outFile << readers << "\t" << persistentRates.first << "\t\t\t" << persistentRates.second << "\t\t\t"
+                << lockedRates.first << "\t\t\t" << lockedRates.second << "\n";
+    }
+}
+
+void writeStats(std::ofstream&, const char*, const NoStats&) {}
+
+// Counters of each kind of operation, averaged per call
+void writeStats(std::ofstream& outFile, const char* tree, const OperationStats& stats) {
+    static const char* NAMES[OPERATION_COUNT] = {"insert", "remove", "search", "scan", "set operation", "build"};
+    outFile << "Counters per operation (" << tree << "):\n";
+    for (int op = 0; op < OPERATION_COUNT; op++) {
+        const OperationStats::Counts& counts = stats.counts[op];
+        if (!counts.calls) continue;
+        double calls = counts.calls;
+        outFile << NAMES[op] << ": " << counts.calls << " calls, "
+                << counts.comparisons / calls << " comparisons, "
+                << counts.visits / calls << " visits, rotations LL/RR/LR/RL "
+                << counts.rotations[ROTATE_LL] / calls << "/" << counts.rotations[ROTATE_RR] / calls << "/"
+                << counts.rotations[ROTATE_LR] / calls << "/" << counts.rotations[ROTATE_RL] / calls << ", "
+                << counts.splits / calls << " splits, " << counts.merges / calls << " merges, "
+                << counts.allocations / calls << " allocations, " << counts.frees / calls << " frees\n";
+    }
+}
+
+// Nonempty buckets of a depth histogram as depth:leaves
+void writeHistogram(std::ofstream& outFile, const char* tree, const DepthStats& depths) {
+    outFile << tree << ":";
+    for (int depth = 0; depth < DepthStats::HISTOGRAM_SIZE; depth++) {
+        if (depths.histogram[depth]) outFile << " " << depth << ":" << depths.histogram[depth];
+    }
+    outFile << "\n";
+}
+
+// All threads insert and remove the same few keys of the lock-free skip list, so
+// removed nodes are often still linked on upper levels when the key comes back.
+// Afterwards no level may hold a marked node or be out of order, and searches
+// must agree with the bottom level.
+void stressSkipList(std::ofstream& outFile) {
+    const int THREADS = 8;
+    const int OPS_PER_THREAD = 200000;
+
+    outFile << "\nLock-free skip list stress check (" << THREADS << " threads, " << OPS_PER_THREAD
+            << " mixed ops each)\n";
+    for (int hotKeys : {1, 4, 16}) {
+        LockFreeSkipList<int> list;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < THREADS; t++) {
+            workers.emplace_back([&, t]() {
+                std::mt19937 local(t + hotKeys);
+                std::uniform_int_distribution<> dis(0, hotKeys - 1);
+                for (int i = 0; i < OPS_PER_THREAD; i++) {
+                    int key = dis(local);
+                    int kind = local() % 3;
+                    if (kind == 0) list.insert(key);
+                    else if (kind == 1) list.remove(key);
+                    else list.search(key);
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        bool ok = list.isConsistent();
+        DepthStats heights = list.getLevelStats();
+        unsigned long long present = 0;
+        for (int key = 0; key < hotKeys; key++) {
+            present += list.search(key);
+        }
+        ok = ok && present == heights.leaves;
+        outFile << "Keys " << hotKeys << ": " << (ok ? "ok" : "FAILED") << ", " << present << " present\n";
+    }
+}
+
+// The lock-free skip list against a treap and an AVL tree behind one mutex, on
+// the workload of main: a set of N shuffled keys, then equal shares of inserts of
+// new keys, removes of existing keys and searches, now split over 1 ... all cores
+// threads. Every configuration runs in its own child process.
+void benchmarkConcurrentSets(std::ofstream& outFile, std::mt19937& gen) {
+    const int N = 1 << 18;
+    const int OPERATIONS = 1 << 19; // over all threads
+
+    std::vector<int> values(N);
+    for (int j = 0; j < N; j++) {
+        values[j] = j;
+    }
+    std::shuffle(values.begin(), values.end(), gen);
+
+    // Operations as (kind, key): 0 insert, 1 remove, 2 search
+    std::vector<std::pair<int, int>> operations(OPERATIONS);
+    for (auto& [kind, key] : operations) {
+        kind = std::uniform_int_distribution<>(0, 2)(gen);
+        if (kind == 0) key = std::uniform_int_distribution<>(N, N * 2)(gen);
+        else if (kind == 1) key = std::uniform_int_distribution<>(0, N - 1)(gen);
+        else key = std::uniform_int_distribution<>(0, N * 2)(gen);
+    }
+
+    // Fill set, then time the threads each working through their share of the
+    // operations; returns Mops/s and the set's max depth (levels for the list)
+    auto run = [&](unsigned threadCount, auto& set, auto apply) {
+        for (int value : values) set.insert(value);
+        std::atomic<long> found{0};
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t]() {
+                size_t begin = OPERATIONS * size_t(t) / threadCount;
+                size_t end = OPERATIONS * size_t(t + 1) / threadCount;
+                long hits = 0;
+                for (size_t i = begin; i < end; i++) hits += apply(operations[i].first, operations[i].second);
+                found += hits;
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+        auto finish = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(finish - start).count();
+        return std::vector<double>{OPERATIONS / seconds / 1e6, (double)set.getMaxDepth()};
+    };
+
+    // One mutex around every operation of a tree. Treap::insert would add a
+    // duplicate, so insert only absent keys to keep all contenders the same set.
+    auto locked = [](auto& tree, std::mutex& lock) {
+        return [&tree, &lock](int kind, int key) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (kind == 0) {
+                if (!tree.search(key)) tree.insert(key);
+            } else if (kind == 1) {
+                tree.remove(key);
+            } else {
+                return tree.search(key);
+            }
+            return false;
+        };
+    };
+
+    outFile << "\nLock-free skip list vs mutex-wrapped trees (N = " << N << ", "
+            << OPERATIONS << " operations)\n";
+    outFile << "Threads\tSkip list (Mops/s)\tLocked treap (Mops/s)\tLocked AVL (Mops/s)\t"
+            << "Max depth skip list/treap/AVL\n";
+
+    // Powers of two up to at least 4, and every core as the last point
+    std::vector<unsigned> threadCounts;
+    unsigned cores = std::thread::hardware_concurrency();
+    for (unsigned threadCount = 1; threadCount <= std::max(4u, cores); threadCount *= 2) {
+        threadCounts.push_back(threadCount);
+    }
+    if (cores > threadCounts.back()) threadCounts.push_back(cores);
+
+    for (unsigned threadCount : threadCounts) {
+        std::vector<double> list = measureInChild(2, [&]() {
+            LockFreeSkipList<int> set;
+            return run(threadCount, set, [&set](int kind, int key) {
+                if (kind == 0) set.insert(key);
+                else if (kind == 1) set.remove(key);
+                else return set.search(key);
+                return false;
+            });
+        });
+        std::vector<double> treap = measureInChild(2, [&]() {
+            Treap<int> set;
+            std::mutex lock;
+            return run(threadCount, set, locked(set, lock));
+        });
+        std::vector<double> avl = measureInChild(2, [&]() {
+            AVLTree<int> set;
+            std::mutex lock;
+            return run(threadCount, set, locked(set, lock));
+        });
+        outFile << threadCount << "\t" << list[0] << "\t\t\t" << treap[0] << "\t\t\t" << avl[0] << "\t\t\t"
+                << list[1] << "/" << treap[1] << "/" << avl[1] << "\n";
+    }
+
+    // Tower heights should halve level by level
+    LockFreeSkipList<int> list;
+    for (int value : values) list.insert(value);
+    DepthStats heights = list.getLevelStats();
+    outFile << "Skip list node heights (mean " << heights.mean() << ", height:nodes)\n";
+    writeHistogram(outFile, "Skip list", heights);
+}
+
+// Zipfian ranks 0 ... n - 1, rank 0 the most popular, drawn in O(1) by the
+// method of Gray et al. that YCSB uses. zeta(n) is summed once up front.
+class ZipfianGenerator {
+private:
+    uint64_t items;
+    double theta, alpha, zetan, eta;
+
+public:
+    explicit ZipfianGenerator(uint64_t n, double skew = 0.99) : items(n), theta(skew) {
+        zetan = 0;
+        for (uint64_t i = 1; i <= n; i++) zetan += 1 / std::pow(double(i), theta);
+        double zeta2 = 1 + 1 / std::pow(2.0, theta);
+        alpha = 1 / (1 - theta);
+        eta = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan);
+    }
+
+    template<typename Rng>
+    uint64_t operator()(Rng& rng) {
+        double u = std::uniform_real_distribution<>(0, 1)(rng);
+        double uz = u * zetan;
+        if (uz < 1) return 0;
+        if (uz < 1 + std::pow(0.5, theta)) return 1;
+        return std::min<uint64_t>(items - 1, uint64_t(items * std::pow(eta * u - eta + 1, alpha)));
+    }
+};
+
+// How the workload generator picks the key of a read, remove or scan:
+// - uniform over the keys inserted so far
+// - Zipfian over the keys inserted so far, ranks scattered by a hash
+// - hotspot: 80% of the picks go to the lowest 20% of the keys
+// - latest: Zipfian by age, the most recently inserted key the most popular
+enum KeyDistribution { KEYS_UNIFORM, KEYS_ZIPFIAN, KEYS_HOTSPOT, KEYS_LATEST };
+
+enum WorkloadKind : uint8_t { WORKLOAD_READ, WORKLOAD_INSERT, WORKLOAD_REMOVE, WORKLOAD_SCAN };
+
+// Shares of each kind of operation (summing to 1) and how keys are picked
+struct WorkloadMix {
+    const char* name;
+    double read, insert, remove, scan;
+    KeyDistribution distribution;
+    int maxScanLength; // scans cover 1 ... maxScanLength keys, uniformly
+};
+
+// One operation of a generated stream, 8 bytes
+struct WorkloadOp {
+    uint32_t key;
+    uint16_t scanLength;
+    uint8_t kind;
+};
+
+// YCSB-style operation streams over a set loaded with keys 0 ... records - 1.
+// Inserts add keys records, records + 1, ... in order. Streams depend only on
+// the seed and the mix, and are generated in full before anything is timed.
+class WorkloadGenerator {
+private:
+    uint32_t records;
+    uint64_t seed;
+
+    // FNV-1a, as YCSB scatters Zipfian ranks
+    static uint64_t scramble(uint64_t value) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (int byte = 0; byte < 8; byte++) {
+            hash ^= (value >> (8 * byte)) & 0xff;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    // Zipfian ranks cover keySpace, which includes keys not inserted yet; as in
+    // YCSB those are drawn again
+    template<typename Rng>
+    uint32_t pickKey(KeyDistribution distribution, uint32_t inserted, ZipfianGenerator& zipfian,
+                     uint64_t keySpace, Rng& rng) {
+        switch (distribution) {
+        case KEYS_ZIPFIAN:
+            while (true) {
+                uint64_t key = scramble(zipfian(rng)) % keySpace;
+                if (key < inserted) return uint32_t(key);
+            }
+        case KEYS_HOTSPOT: {
+            // A single record is the whole hot set, leaving no cold keys
+            uint32_t hot = std::max(1u, inserted / 5);
+            if (hot == inserted || std::uniform_real_distribution<>(0, 1)(rng) < 0.8)
+                return std::uniform_int_distribution<uint32_t>(0, hot - 1)(rng);
+            return std::uniform_int_distribution<uint32_t>(hot, inserted - 1)(rng);
+        }
+        case KEYS_LATEST:
+            while (true) {
+                uint64_t age = zipfian(rng);
+                if (age < inserted) return inserted - 1 - uint32_t(age);
+            }
+        default:
+            return std::uniform_int_distribution<uint32_t>(0, inserted - 1)(rng);
+        }
+    }
+
+public:
+    WorkloadGenerator(uint32_t recordCount, uint64_t randomSeed) : records(recordCount), seed(randomSeed) {}
+
+    std::vector<WorkloadOp> generate(const WorkloadMix& mix, size_t count) {
+        if (records == 0) throw std::invalid_argument("WorkloadGenerator: no records loaded");
+        if (mix.maxScanLength > UINT16_MAX) {
+            throw std::invalid_argument("WorkloadGenerator: scan length does not fit WorkloadOp");
+        }
+        // The loaded keys and the ones the stream is expected to insert
+        uint64_t keySpace = records + uint64_t(count * mix.insert) + 1;
+        ZipfianGenerator zipfian(keySpace);
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<> share(0, 1);
+        std::uniform_int_distribution<int> scanLength(1, std::max(1, mix.maxScanLength));
+        std::vector<WorkloadOp> ops(count);
+        uint32_t inserted = records;
+        for (WorkloadOp& op : ops) {
+            double pick = share(rng);
+            if (pick < mix.read) op.kind = WORKLOAD_READ;
+            else if (pick < mix.read + mix.insert) op.kind = WORKLOAD_INSERT;
+            else if (pick < mix.read + mix.insert + mix.remove) op.kind = WORKLOAD_REMOVE;
+            else op.kind = WORKLOAD_SCAN;
+
+            op.key = op.kind == WORKLOAD_INSERT ? inserted++
+                                                : pickKey(mix.distribution, inserted, zipfian, keySpace, rng);
+            op.scanLength = op.kind == WORKLOAD_SCAN ? scanLength(rng) : 0;
+        }
+        return ops;
+    }
+};
+
+// The trees on interleaved streams from the workload generator instead of the
+// separate uniform phases of main. Mixes follow the YCSB core workloads, with
+// insert and remove in place of update. Each run loads the keys in one fixed
+// shuffled order and times every operation, in its own child process; the
+// percentiles include about 20 ns of clock overhead.
+void benchmarkWorkloads(std::ofstream& outFile) {
+    const uint32_t RECORDS = 1 << 18;
+    const size_t OPERATIONS = 1 << 20;
+    const uint64_t SEED = 2024;
+
+    const WorkloadMix MIXES[] = {
+        {"uniform 50/25/25",     0.50, 0.25,  0.25,  0,    KEYS_UNIFORM, 0},
+        {"A: zipfian 50/25/25",  0.50, 0.25,  0.25,  0,    KEYS_ZIPFIAN, 0},
+        {"B: zipfian 95/2.5/2.5", 0.95, 0.025, 0.025, 0,   KEYS_ZIPFIAN, 0},
+        {"C: zipfian read only", 1.00, 0,     0,     0,    KEYS_ZIPFIAN, 0},
+        {"D: latest 95/5",       0.95, 0.05,  0,     0,    KEYS_LATEST,  0},
+        {"E: zipfian scans",     0,    0.05,  0,     0.95, KEYS_ZIPFIAN, 100},
+        {"hotspot 90/5/5",       0.90, 0.05,  0.05,  0,    KEYS_HOTSPOT, 0},
+    };
+
+    std::vector<int> load(RECORDS);
+    for (uint32_t j = 0; j < RECORDS; j++) {
+        load[j] = j;
+    }
+    std::mt19937 loadOrder(SEED);
+    std::shuffle(load.begin(), load.end(), loadOrder);
+
+    // Mops/s and latency percentiles p50, p99, p99.9 in ns
+    auto run = [&](auto& tree, const std::vector<WorkloadOp>& ops) {
+        for (int value : load) tree.insert(value);
+        std::vector<uint32_t> latencies(ops.size());
+        long found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ops.size(); i++) {
+            const WorkloadOp& op = ops[i];
+            auto before = std::chrono::steady_clock::now();
+            switch (op.kind) {
+            case WORKLOAD_READ: found += tree.search(op.key); break;
+            case WORKLOAD_INSERT: tree.insert(op.key); break;
+            case WORKLOAD_REMOVE: tree.remove(op.key); break;
+            default: found += tree.scan(op.key, op.scanLength); break;
+            }
+            auto after = std::chrono::steady_clock::now();
+            latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        [[maybe_unused]] volatile long sink = found;
+
+        std::vector<double> result{ops.size() / seconds / 1e6};
+        for (double quantile : {0.5, 0.99, 0.999}) {
+            auto nth = latencies.begin() + size_t(quantile * (latencies.size() - 1));
+            std::nth_element(latencies.begin(), nth, latencies.end());
+            result.push_back(*nth);
+        }
+        return result;
+    };
+
+    outFile << "\nWorkload mixes (read/insert/remove shares in the names, " << RECORDS << " keys loaded, "
+            << OPERATIONS << " operations, seed " << SEED << ")\n";
+    outFile << "Mix\tTree\tMops/s\tp50 (ns)\tp99 (ns)\tp99.9 (ns)\n";
+
+    WorkloadGenerator generator(RECORDS, SEED);
+    for (const WorkloadMix& mix : MIXES) {
+        std::vector<WorkloadOp> ops = generator.generate(mix, OPERATIONS);
+        std::vector<double> avl = measureInChild(4, [&]() {
+            AVLTree<int> tree;
+            return run(tree, ops);
+        });
+        std::vector<double> treap = measureInChild(4, [&]() {
+            Treap<int> tree;
+            return run(tree, ops);
+        });
+        outFile << mix.name << "\tAVL\t" << avl[0] << "\t" << avl[1] << "\t" << avl[2] << "\t" << avl[3] << "\n";
+        outFile << mix.name << "\tTreap\t" << treap[0] << "\t" << treap[1] << "\t" << treap[2] << "\t" << treap[3] << "\n";
+    }
+}
+
 int main() {
     std::ofstream outFile("tree_analysis.txt");
     std::random_device rd;
@@ -334,8 +2093,8 @@ int main() {
             }
             std::shuffle(values.begin(), values.end(), gen);
 
-            AVLTree<int> avl;
-            Treap<int> treap;
+            AVLTree<int, AnalysisStats> avl;
+            Treap<int, AnalysisStats> treap;
 
             // Fill both trees
             for (int value : values) {
@@ -348,6 +2107,10 @@ int main() {
             outFile << "AVL: " << avl.getMaxDepth() << "\n";
             outFile << "Treap: " << treap.getMaxDepth() << "\n";
 
+            // Counters cover the timed operations from here on
+            avl.resetStats();
+            treap.resetStats();
+
             // Measure insertion time
             std::vector<int> insertValues(NUM_OPERATIONS);
             for (int& val : insertValues) {
@@ -420,25 +2183,30 @@ int main() {
             outFile << "AVL: " << avl_search_time << "\n";
             outFile << "Treap: " << treap_search_time << "\n";
 
-            // Get all depths
-            auto avl_depths = avl.getAllDepths();
-            auto treap_depths = treap.getAllDepths();
-
-            double avl_avg_depth = 0;
-            double treap_avg_depth = 0;
+            // Leaf depths in one pass, without a vector of all of them
+            DepthStats avl_depths = avl.getDepthStats();
+            DepthStats treap_depths = treap.getDepthStats();
 
-            for (int depth : avl_depths) avl_avg_depth += depth;
-            for (int depth : treap_depths) treap_avg_depth += depth;
+            outFile << "Average depths:\n";
+            outFile << "AVL: " << avl_depths.mean() << "\n";
+            outFile << "Treap: " << treap_depths.mean() << "\n";
 
-            avl_avg_depth /= avl_depths.size();
-            treap_avg_depth /= treap_depths.size();
+            outFile << "Leaf depth histograms (depth:leaves):\n";
+            writeHistogram(outFile, "AVL", avl_depths);
+            writeHistogram(outFile, "Treap", treap_depths);
 
-            outFile << "Average depths:\n";
-            outFile << "AVL: " << avl_avg_depth << "\n";
-            outFile << "Treap: " << treap_avg_depth << "\n";
+            writeStats(outFile, "AVL", avl.getStats());
+            writeStats(outFile, "Treap", treap.getStats());
         }
     }
 
+    benchmarkSetOperations(outFile, gen);
+    benchmarkSortedBuild(outFile, gen);
+    benchmarkSnapshots(outFile, gen);
+    stressSkipList(outFile);
+    benchmarkConcurrentSets(outFile, gen);
+    benchmarkWorkloads(outFile);
+
     outFile.close();
     return 0;
 }